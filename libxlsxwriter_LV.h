@@ -57,6 +57,18 @@ typedef unsigned long lxw_styles;
 typedef unsigned long lxw_relationships;
 typedef unsigned long lxw_drawing;
 typedef unsigned long lxw_file_handle;
+typedef unsigned long lxw_staging_table;
+typedef unsigned long lxw_staging_filter;
+typedef unsigned long lxw_label_table;
+
+/* LabVIEW 1D string array. In the Call Library Function Node configure the
+ * parameter as "Adapt to Type" with "Handles by Value" and wire a string
+ * array directly; no string pointers need to be built. */
+typedef unsigned long lv_str_array_handle;
+
+/* LabVIEW 1D array of any type, configured the same way as
+ * lv_str_array_handle. */
+typedef unsigned long lv_array_handle;
 
 /* ============================================================================
  * Error Codes
@@ -473,6 +485,12 @@ lxw_workbook workbook_new_opt(const char *filename, unsigned long options);
 lxw_format workbook_add_format(lxw_workbook workbook);
 lxw_chart workbook_add_chart(lxw_workbook workbook, uint8_t chart_type);
 lxw_error workbook_close(lxw_workbook workbook);
+
+/* Close a workbook after applying chart_series_bind_rows_lv() bindings.
+ * Required instead of workbook_close() once any series is bound, since it
+ * also releases the bindings (workbook_close() leaves them allocated).
+ * Can be used in place of workbook_close() for any workbook. */
+lxw_error workbook_close_lv(lxw_workbook workbook);
 lxw_error workbook_set_properties(lxw_workbook workbook, unsigned long properties);
 lxw_error workbook_set_custom_property_number(lxw_workbook workbook, const char *name, double value);
 lxw_error workbook_set_custom_property_integer(lxw_workbook workbook, const char *name, int32_t value);
@@ -539,6 +557,10 @@ void worksheet_split_panes_opt(lxw_worksheet worksheet, double vertical, double
 lxw_error worksheet_filter_column_lv(lxw_worksheet worksheet, lxw_col_t col, uint8_t criteria, const char *value_string, double value);
 lxw_error worksheet_filter_column2_lv(lxw_worksheet worksheet, lxw_col_t col, uint8_t criteria1, const char *value_string1, double value1, uint8_t criteria2, const char *value_string2, double value2, uint8_t and_or);
 
+/* Filter a column to a list of values, e.g. "East", "North". values is a
+ * LabVIEW string array; include "Blanks" to also match blank cells. */
+lxw_error worksheet_filter_list_lv(lxw_worksheet worksheet, lxw_col_t col, lv_str_array_handle values);
+
 
 lxw_error worksheet_set_selection(lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, lxw_row_t last_row, lxw_col_t last_col);
 void worksheet_set_top_left_cell(lxw_worksheet worksheet, lxw_row_t row, lxw_col_t col);
@@ -879,6 +901,23 @@ void worksheet_set_comments_author_lv(lxw_worksheet worksheet, const char *autho
 lxw_error worksheet_insert_textbox_lv(lxw_worksheet worksheet, lxw_row_t row, lxw_col_t col, const char *text);
 lxw_error worksheet_insert_textbox_opt_lv(lxw_worksheet worksheet, lxw_row_t row, lxw_col_t col, const char *text, lxw_textbox_options *options);
 
+/* A rich string cell for worksheet_write_rich_strings_lv(): it uses the
+ * next num_fragments fragments. format_index selects the cell format from
+ * the palette (out of range, e.g. 0xFFFF, for none). 12 bytes. */
+typedef struct lxw_rich_cell {
+    lxw_row_t row;
+    uint32_t num_fragments;
+    lxw_col_t col;
+    uint16_t format_index;
+} lxw_rich_cell;
+
+/* Write many rich string cells in one call. fragments is a LabVIEW string
+ * array of all cells' fragments in order; fragment_formats (optional)
+ * gives each fragment's palette index, out of range for the default
+ * format. format_palette is an array of format handles (pointer-sized
+ * integers). Empty fragments are skipped. */
+lxw_error worksheet_write_rich_strings_lv(lxw_worksheet worksheet, const lxw_rich_cell *cells, uint32_t num_cells, lv_str_array_handle fragments, const uint16_t *fragment_formats, const uintptr_t *format_palette, uint32_t palette_size);
+
 /* Chartsheet functions */
 lxw_error chartsheet_set_header_lv(lxw_chartsheet chartsheet, const char *header);
 lxw_error chartsheet_set_footer_lv(lxw_chartsheet chartsheet, const char *footer);
@@ -909,6 +948,37 @@ lxw_error chart_series_set_labels_custom_lv(lxw_chart_series series,
                                             uint8_t *hide_flags,
                                             uint16_t count);
 
+/* Font and fill for data labels, selected per label by index. A font that
+ * is all zeros, or a fill with color 0 and fill_none 0, is left unset.
+ * 24 bytes, no padding. */
+typedef struct lxw_label_style {
+    double font_size;
+    int32_t font_rotation;
+    lxw_color_t font_color;
+    lxw_color_t fill_color;
+    uint8_t font_bold;
+    uint8_t font_italic;
+    uint8_t fill_none;
+    uint8_t fill_transparency;
+} lxw_label_style;
+
+/* Extended custom data labels (up to 65535). Each label's text is, in
+ * order: a non-empty element of strings (LabVIEW string array, "Adapt to
+ * Type"), a non-NaN element of values formatted with value_format, or the
+ * default label. value_format is printf style with one %f/%e/%g ("%.2f V")
+ * or simple Excel style ("#,##0.00", "0.0%"); empty means "%g". An invalid
+ * format returns LXW_ERROR_PARAMETER_VALIDATION. style_indices pick an
+ * entry of styles per label (out of range for none). strings, values,
+ * hide_flags and style_indices may each be NULL/empty. */
+lxw_error chart_series_set_labels_custom2_lv(lxw_chart_series series, uint32_t count, lv_str_array_handle strings, const double *values, const char *value_format, const uint8_t *hide_flags, const uint8_t *style_indices, const lxw_label_style *styles, uint32_t num_styles);
+
+/* Color the points of a series (e.g. pass/fail bars or pie slices).
+ * palette_mode 0: colors[] holds LabVIEW RGB colors; transparent or system
+ * colors (high byte set) leave a point at its default.
+ * palette_mode 1: colors[] holds indices into palette[]; out of range
+ * indices leave a point at its default. At most 65535 points. */
+lxw_error chart_series_set_point_colors_lv(lxw_chart_series series, const uint32_t *colors, uint32_t count, const uint32_t *palette, uint32_t palette_size, uint8_t palette_mode);
+
 /* Chart functions with sheetname parameters */
 void chart_series_set_categories_lv(lxw_chart_series series, const char *sheetname, lxw_row_t first_row, lxw_col_t first_col, lxw_row_t last_row, lxw_col_t last_col);
 void chart_series_set_values_lv(lxw_chart_series series, const char *sheetname, lxw_row_t first_row, lxw_col_t first_col, lxw_row_t last_row, lxw_col_t last_col);
@@ -916,6 +986,214 @@ void chart_series_set_name_range_lv(lxw_chart_series series, const char *sheetna
 void chart_axis_set_name_range_lv(lxw_chart_axis axis, const char *sheetname, lxw_row_t row, lxw_col_t col);
 void chart_title_set_name_range_lv(lxw_chart chart, const char *sheetname, lxw_row_t row, lxw_col_t col);
 
+/* Don't store cached series data in the chart (Excel recomputes it on
+ * open). Smaller files and a faster close for long series. Call after
+ * adding the series. */
+void chart_set_ignore_cache_lv(lxw_chart chart, uint8_t ignore_cache);
+
+/* Bind a series (added with empty category/value ranges) to a worksheet
+ * column from first_row down to the last row written. The series gets a
+ * one row range at first_row straight away, so the chart can be inserted
+ * with worksheet_insert_chart()/chartsheet_set_chart() before any data is
+ * written; workbook_close_lv() widens it to the last row. The workbook
+ * must be closed with workbook_close_lv(). categories_col is -1 for no
+ * categories. values_name/categories_name optionally define workbook names
+ * for the final ranges (empty strings for none). Lets a logging chart be
+ * set up before the number of rows is known. */
+lxw_error chart_series_bind_rows_lv(lxw_workbook workbook, lxw_chart_series series, lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t values_col, int32_t categories_col, const char *values_name, const char *categories_name);
+
+/* Bits of lxw_axis_spec.present. Only the settings whose bit is set are
+ * applied by chart_axis_configure_lv(). */
+enum lxw_axis_spec_present {
+    LXW_AXIS_SPEC_MIN = 1 << 0,
+    LXW_AXIS_SPEC_MAX = 1 << 1,
+    LXW_AXIS_SPEC_MAJOR_UNIT = 1 << 2,
+    LXW_AXIS_SPEC_MINOR_UNIT = 1 << 3,
+    LXW_AXIS_SPEC_LOG_BASE = 1 << 4,
+    LXW_AXIS_SPEC_CROSSING = 1 << 5,
+    LXW_AXIS_SPEC_POSITION = 1 << 6,
+    LXW_AXIS_SPEC_LABEL_POSITION = 1 << 7,
+    LXW_AXIS_SPEC_LABEL_ALIGN = 1 << 8,
+    LXW_AXIS_SPEC_TICK_MARKS = 1 << 9,
+    LXW_AXIS_SPEC_INTERVAL_UNIT = 1 << 10,
+    LXW_AXIS_SPEC_INTERVAL_TICK = 1 << 11,
+    LXW_AXIS_SPEC_DISPLAY_UNITS = 1 << 12,
+    LXW_AXIS_SPEC_MAJOR_GRIDLINES = 1 << 13,
+    LXW_AXIS_SPEC_MINOR_GRIDLINES = 1 << 14,
+    LXW_AXIS_SPEC_NUM_FONT = 1 << 15,
+    LXW_AXIS_SPEC_NAME_FONT = 1 << 16,
+    LXW_AXIS_SPEC_LINE = 1 << 17,
+    LXW_AXIS_SPEC_REVERSE = 1 << 18,
+    LXW_AXIS_SPEC_OFF = 1 << 19,
+    LXW_AXIS_SPEC_NAME = 1 << 20,
+    LXW_AXIS_SPEC_NUM_FORMAT = 1 << 21
+};
+
+/* lxw_axis_spec.crossing_type values. */
+enum lxw_axis_spec_crossing {
+    LXW_AXIS_SPEC_CROSSING_VALUE = 0,
+    LXW_AXIS_SPEC_CROSSING_MIN,
+    LXW_AXIS_SPEC_CROSSING_MAX
+};
+
+/* Full axis configuration as one cluster (136 bytes, no padding, so it
+ * matches on 32 and 64-bit LabVIEW). Colors of 0 leave the default. */
+typedef struct lxw_axis_spec {
+    double min;
+    double max;
+    double major_unit;
+    double minor_unit;
+    double crossing;
+    double num_font_size;
+    double name_font_size;
+    double line_width;
+    double major_gridlines_width;
+    double minor_gridlines_width;
+    uint32_t present;
+    int32_t num_font_rotation;
+    lxw_color_t num_font_color;
+    lxw_color_t name_font_color;
+    lxw_color_t line_color;
+    lxw_color_t major_gridlines_color;
+    lxw_color_t minor_gridlines_color;
+    uint16_t log_base;
+    uint16_t interval_unit;
+    uint16_t interval_tick;
+    uint8_t crossing_type;
+    uint8_t position;
+    uint8_t label_position;
+    uint8_t label_align;
+    uint8_t major_tick_mark;
+    uint8_t minor_tick_mark;
+    uint8_t display_units;
+    uint8_t display_units_visible;
+    uint8_t major_gridlines_visible;
+    uint8_t minor_gridlines_visible;
+    uint8_t major_gridlines_dash_type;
+    uint8_t minor_gridlines_dash_type;
+    uint8_t line_none;
+    uint8_t line_dash_type;
+    uint8_t num_font_bold;
+    uint8_t num_font_italic;
+    uint8_t name_font_bold;
+    uint8_t name_font_italic;
+    uint8_t reserved[4];
+} lxw_axis_spec;
+
+/* Configure an axis (from chart_get_x_axis() etc.) in one call. name and
+ * num_format are used with the LXW_AXIS_SPEC_NAME/NUM_FORMAT bits. */
+void chart_axis_configure_lv(lxw_chart_axis axis, const lxw_axis_spec *spec, const char *name, const char *num_format);
+
+/* Bits of lxw_series_spec.present. */
+enum lxw_series_spec_present {
+    LXW_SERIES_SPEC_LINE = 1 << 0,
+    LXW_SERIES_SPEC_FILL = 1 << 1,
+    LXW_SERIES_SPEC_INVERT_IF_NEGATIVE = 1 << 2,
+    LXW_SERIES_SPEC_SMOOTH = 1 << 3,
+    LXW_SERIES_SPEC_MARKER_TYPE = 1 << 4,
+    LXW_SERIES_SPEC_MARKER_SIZE = 1 << 5,
+    LXW_SERIES_SPEC_MARKER_LINE = 1 << 6,
+    LXW_SERIES_SPEC_MARKER_FILL = 1 << 7,
+    LXW_SERIES_SPEC_LABELS = 1 << 8,
+    LXW_SERIES_SPEC_LABELS_POSITION = 1 << 9,
+    LXW_SERIES_SPEC_LABELS_SEPARATOR = 1 << 10,
+    LXW_SERIES_SPEC_LABELS_LEADER_LINE = 1 << 11,
+    LXW_SERIES_SPEC_LABELS_LEGEND = 1 << 12,
+    LXW_SERIES_SPEC_LABELS_PERCENTAGE = 1 << 13,
+    LXW_SERIES_SPEC_LABELS_FONT = 1 << 14,
+    LXW_SERIES_SPEC_LABELS_FILL = 1 << 15,
+    LXW_SERIES_SPEC_LABELS_NUM_FORMAT = 1 << 16,
+    LXW_SERIES_SPEC_TRENDLINE = 1 << 17,
+    LXW_SERIES_SPEC_TRENDLINE_FORECAST = 1 << 18,
+    LXW_SERIES_SPEC_TRENDLINE_EQUATION = 1 << 19,
+    LXW_SERIES_SPEC_TRENDLINE_R_SQUARED = 1 << 20,
+    LXW_SERIES_SPEC_TRENDLINE_INTERCEPT = 1 << 21,
+    LXW_SERIES_SPEC_TRENDLINE_LINE = 1 << 22,
+    LXW_SERIES_SPEC_TRENDLINE_NAME = 1 << 23
+};
+
+/* Full series style as one cluster (120 bytes, no padding). Colors of 0
+ * leave the default. */
+typedef struct lxw_series_spec {
+    double line_width;
+    double marker_line_width;
+    double labels_font_size;
+    double trendline_line_width;
+    double trendline_forward;
+    double trendline_backward;
+    double trendline_intercept;
+    uint32_t present;
+    int32_t labels_font_rotation;
+    lxw_color_t line_color;
+    lxw_color_t fill_color;
+    lxw_color_t marker_line_color;
+    lxw_color_t marker_fill_color;
+    lxw_color_t labels_font_color;
+    lxw_color_t labels_fill_color;
+    lxw_color_t trendline_line_color;
+    uint8_t line_none;
+    uint8_t line_dash_type;
+    uint8_t line_transparency;
+    uint8_t fill_none;
+    uint8_t fill_transparency;
+    uint8_t smooth;
+    uint8_t marker_type;
+    uint8_t marker_size;
+    uint8_t marker_line_none;
+    uint8_t marker_fill_none;
+    uint8_t labels_show_name;
+    uint8_t labels_show_category;
+    uint8_t labels_show_value;
+    uint8_t labels_position;
+    uint8_t labels_separator;
+    uint8_t labels_font_bold;
+    uint8_t labels_font_italic;
+    uint8_t labels_fill_none;
+    uint8_t trendline_type;
+    uint8_t trendline_value;
+    uint8_t trendline_line_dash_type;
+    uint8_t reserved[7];
+} lxw_series_spec;
+
+/* Style a series in one call. labels_num_format and trendline_name are
+ * used with the LABELS_NUM_FORMAT/TRENDLINE_NAME bits. */
+void chart_series_configure_lv(lxw_chart_series series, const lxw_series_spec *spec, const char *labels_num_format, const char *trendline_name);
+
+/* Apply one spec to an array of series handles (pointer-sized integers).
+ * Zero handles are skipped. */
+lxw_error chart_series_configure_many_lv(uintptr_t *series, uint32_t count, const lxw_series_spec *spec, const char *labels_num_format, const char *trendline_name);
+
+/* Shared style for workbook_add_chartsheets_lv() charts (400 bytes, no
+ * padding). paper_type 0 keeps the default paper. */
+typedef struct lxw_chart_template {
+    lxw_series_spec series;
+    lxw_axis_spec x_axis;
+    lxw_axis_spec y_axis;
+    uint8_t chart_type;
+    uint8_t style;
+    uint8_t title_from_name;
+    uint8_t legend_none;
+    uint8_t paper_type;
+    uint8_t portrait;
+    uint8_t reserved[2];
+} lxw_chart_template;
+
+/* Rows of a value column and optional category column (-1 for none). */
+typedef struct lxw_chart_data_range {
+    lxw_row_t first_row;
+    lxw_row_t last_row;
+    int32_t categories_col;
+    lxw_col_t values_col;
+    uint16_t reserved;
+} lxw_chart_data_range;
+
+/* Create one chartsheet per name (LabVIEW string array), each with a
+ * single-series chart of data_ranges[i] in data_worksheet, all styled from
+ * chart_template. Axis names are used with the axis specs' NAME bits.
+ * chartsheets_out (optional, pointer-sized integers, one per name) gets
+ * each chartsheet or 0 on failure. Returns the first error. */
+lxw_error workbook_add_chartsheets_lv(lxw_workbook workbook, lv_str_array_handle names, const lxw_chart_template *chart_template, lxw_worksheet data_worksheet, const lxw_chart_data_range *data_ranges, const char *x_axis_name, const char *y_axis_name, uintptr_t *chartsheets_out);
+
 /* File path functions (ANSI to UTF-8 conversion for file operations) */
 lxw_workbook workbook_new_lv(const char *filename);
 lxw_workbook workbook_new_opt_lv(const char *filename, lxw_workbook_options *options);
@@ -927,4 +1205,345 @@ lxw_error worksheet_set_background_lv(lxw_worksheet worksheet, const char *filen
 lxw_error workbook_add_vba_project_lv(lxw_workbook workbook, const char *filename);
 lxw_error workbook_add_signed_vba_project_lv(lxw_workbook workbook, const char *vba_project, const char *signature);
 
+/* ============================================================================
+ * Staging Table Functions
+ *
+ * A staging table holds column data inside the DLL so that large datasets
+ * can be sorted and written without copying arrays of clusters in G.
+ * Rows are written by staging_table_emit_lv in the table's current order.
+ * ============================================================================ */
+
+typedef enum lxw_staging_column_type {
+    LXW_STAGING_COLUMN_NUMBER = 0,
+    LXW_STAGING_COLUMN_STRING = 1
+} lxw_staging_column_type;
+
+/* Create a table with num_cols columns typed by col_types (array of
+ * lxw_staging_column_type). Free it with staging_table_free_lv. */
+lxw_staging_table staging_table_new_lv(const uint8_t *col_types, uint16_t num_cols);
+void staging_table_free_lv(lxw_staging_table table);
+uint32_t staging_table_num_rows_lv(lxw_staging_table table);
+
+/* Append values to a column. Columns may be filled independently; cells
+ * past the end of a shorter column are blank, as are NaN numbers and empty
+ * strings. Appending rows resets any sort order. */
+lxw_error staging_table_append_numbers_lv(lxw_staging_table table, lxw_col_t col, const double *values, uint32_t count);
+lxw_error staging_table_append_strings_lv(lxw_staging_table table, lxw_col_t col, lv_str_array_handle strings);
+
+/* Name the columns, used for summary headers. Names are applied to
+ * columns 0..n-1. */
+lxw_error staging_table_set_column_names_lv(lxw_staging_table table, lv_str_array_handle names);
+
+/* Sort rows by one or more key columns. key_cols and descending are
+ * parallel arrays (descending may be NULL for all ascending). The sort is
+ * stable, strings sort by byte value and blanks sort last. Only the row
+ * order changes; column data is not moved. */
+lxw_error staging_table_sort_lv(lxw_staging_table table, const uint16_t *key_cols, const uint8_t *descending, uint16_t num_keys);
+
+/* Write all rows starting at first_row/first_col in the current order.
+ * col_formats is an optional array of one lxw_format handle per column
+ * (0 for no format). */
+lxw_error staging_table_emit_lv(lxw_staging_table table, lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, uintptr_t *col_formats);
+
+typedef enum lxw_staging_aggregate {
+    LXW_STAGING_AGGREGATE_SUM = 0,
+    LXW_STAGING_AGGREGATE_COUNT = 1,
+    LXW_STAGING_AGGREGATE_MIN = 2,
+    LXW_STAGING_AGGREGATE_MAX = 3,
+    LXW_STAGING_AGGREGATE_MEAN = 4
+} lxw_staging_aggregate;
+
+/* Group rows by the key columns and write a pivot-style summary block at
+ * first_row/first_col: a header row ("Sum of Value", ...) then one row per
+ * group, in order of first appearance (sort first for a sorted summary).
+ * agg_cols and agg_types (lxw_staging_aggregate) are parallel arrays; only
+ * COUNT is allowed on string columns and blank cells are not aggregated.
+ * If chart is not 0, one series per aggregate is added against the first
+ * key column and the chart is inserted to the right of the block.
+ * num_groups_out may be NULL. */
+lxw_error staging_table_group_by_lv(lxw_staging_table table, const uint16_t *key_cols, uint16_t num_keys, const uint16_t *agg_cols, const uint8_t *agg_types, uint16_t num_aggs, lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, lxw_format header_format, lxw_format number_format, lxw_chart chart, uint32_t *num_groups_out);
+
+/* Compile a row filter expression such as
+ *     col3 > 5 and col7 == "FAIL"
+ * Columns are 0-based, comparisons are == != < <= > >= (also = and <>),
+ * strings are double quoted and and/or/not may be written &&, ||, !.
+ * Returns 0 on a syntax error and sets error_offset to the position of the
+ * error (-1 on success). "not" and parentheses nested more than 256 deep
+ * are a syntax error. A compiled filter can be reused on any table. */
+lxw_staging_filter staging_filter_compile_lv(const char *expression, int32_t *error_offset);
+void staging_filter_free_lv(lxw_staging_filter filter);
+
+/* Select the rows matching a filter. Emit and group-by then skip rows that
+ * are not selected, without copying any data. Blank cells compare as ""
+ * and fail numeric comparisons. Appending rows selects all rows again. */
+lxw_error staging_table_select_lv(lxw_staging_table table, lxw_staging_filter filter, uint32_t *num_selected_out);
+void staging_table_select_all_lv(lxw_staging_table table);
+
+/* Autofilter a column of the block last written by staging_table_emit_lv()
+ * and hide the rows that don't match, so the file opens already filtered.
+ * col is the worksheet column and the arguments are as for
+ * worksheet_filter_column_lv()/worksheet_filter_column2_lv(). Call
+ * worksheet_autofilter() over the block first. Hidden rows lose any row
+ * height or format set on them; not for use in constant_memory mode.
+ * num_hidden_out (may be NULL) gets the number of newly hidden rows. */
+lxw_error staging_table_filter_column_lv(lxw_staging_table table, lxw_col_t col, uint8_t criteria, const char *value_string, double value, uint32_t *num_hidden_out);
+lxw_error staging_table_filter_column2_lv(lxw_staging_table table, lxw_col_t col, uint8_t criteria1, const char *value_string1, double value1, uint8_t criteria2, const char *value_string2, double value2, uint8_t and_or, uint32_t *num_hidden_out);
+
+/* ============================================================================
+ * Typed Numeric Array Functions
+ * ============================================================================ */
+
+/* Element type of the data passed to the typed numeric writers. */
+typedef enum lxw_numeric_type {
+    LXW_NUMERIC_I8 = 0,
+    LXW_NUMERIC_I16 = 1,
+    LXW_NUMERIC_I32 = 2,
+    LXW_NUMERIC_I64 = 3,
+    LXW_NUMERIC_U8 = 4,
+    LXW_NUMERIC_U16 = 5,
+    LXW_NUMERIC_U32 = 6,
+    LXW_NUMERIC_U64 = 7,
+    LXW_NUMERIC_SGL = 8,
+    LXW_NUMERIC_DBL = 9
+} lxw_numeric_type;
+
+/* Write a 2D array (row-major, as LabVIEW passes it) of any numeric type
+ * starting at first_row/first_col. Each cell is written as
+ * value * scales[col] + offsets[col]; scales and offsets are optional
+ * arrays of num_cols values (0 for 1 and 0). NaN/Inf cells are left blank. */
+lxw_error worksheet_write_numeric_array_lv(lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, const void *data, uint8_t data_type, uint32_t num_rows, uint16_t num_cols, const double *scales, const double *offsets, lxw_format format);
+
+/* Append typed values to a number column of a staging table, converted as
+ * value * scale + offset (pass 1 and 0 to store the raw values). */
+lxw_error staging_table_append_numeric_lv(lxw_staging_table table, lxw_col_t col, const void *values, uint8_t data_type, uint32_t count, double scale, double offset);
+
+/* Write a 2D boolean array (row-major) starting at first_row/first_col.
+ * data is a LabVIEW boolean array (1 byte per element) or, with packed = 1,
+ * a bitset with the elements in order, LSB first. With as_checkbox = 1 the
+ * cells are checkboxes; a non-0 format is then made a checkbox format. */
+lxw_error worksheet_write_boolean_array_lv(lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, const uint8_t *data, uint8_t packed, uint32_t num_rows, uint16_t num_cols, lxw_format format, uint8_t as_checkbox);
+
+/* ============================================================================
+ * Cluster Array Functions
+ * ============================================================================ */
+
+/* Write an array of clusters, one row per element and one column per
+ * scalar element (nested clusters are flattened). type_desc is the type
+ * string of the array or its element: the I16 array from Variant To
+ * Flattened String (i16_array = 1) or the legacy Flatten To String type
+ * string (i16_array = 0); type_desc_size is its number of elements.
+ * Supports numerics, enums (written as item text), booleans, strings and
+ * timestamps (written in UTC as dates with date_format). With write_header
+ * the element labels are written first. Returns
+ * LXW_ERROR_FEATURE_NOT_SUPPORTED for other element types. */
+lxw_error worksheet_write_cluster_array_lv(lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, const void *type_desc, int32_t type_desc_size, uint8_t i16_array, lv_array_handle array, uint8_t write_header, lxw_format header_format, lxw_format date_format, uint32_t *num_rows_out);
+
+/* ============================================================================
+ * Label Table Functions
+ * ============================================================================ */
+
+/* Create a table of enum/ring item text (index 0 first) from a LabVIEW
+ * string array. Create it once and reuse it for every write; free it with
+ * label_table_free_lv() when done. */
+lxw_label_table label_table_new_lv(lv_str_array_handle labels);
+void label_table_free_lv(lxw_label_table labels);
+
+/* Write an integer column (lxw_numeric_type I8..U64) as label text from
+ * first_row down. Out of range values are written as numbers. */
+lxw_error worksheet_write_labels_lv(lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t col, const void *indices, uint8_t data_type, uint32_t count, lxw_label_table labels, lxw_format format);
+
+/* Append an integer column to a string column of a staging table as label
+ * text. Out of range values are appended as blanks. */
+lxw_error staging_table_append_labels_lv(lxw_staging_table table, lxw_col_t col, const void *indices, uint8_t data_type, uint32_t count, lxw_label_table labels);
+
+/* ============================================================================
+ * TDMS Conversion Functions
+ * ============================================================================ */
+
+/* Convert a TDMS file to a new XLSX file, one worksheet per group. Each
+ * sheet has the group and channel properties as a header block, then a
+ * "Sample" column and one column per channel. Groups longer than Excel's
+ * row limit continue on numbered sheets. If chart_points is not 0, a line
+ * chart of the numeric channels, decimated to at most chart_points points,
+ * is added beside each group's data. The output is written in
+ * constant_memory mode. num_groups_out may be NULL. */
+lxw_error tdms_convert_lv(const char *tdms_filename, const char *xlsx_filename, uint32_t chart_points, uint32_t *num_groups_out);
+
+/* ============================================================================
+ * JSON Import Functions
+ * ============================================================================ */
+
+/* Import a JSON array of objects, or newline delimited objects, as rows.
+ * source is a file path (source_is_path = 1, memory mapped) or the JSON
+ * text. column_map lists the keys to import by column, relative to
+ * first_col; pass an empty array to import all keys in order of first
+ * appearance. Numbers, strings and booleans keep their type; null and
+ * nested values are left blank. With write_header the keys are written
+ * first. num_rows_out (may be NULL) gets the number of data rows. */
+lxw_error xlsx_import_json_lv(lxw_worksheet worksheet, lxw_row_t first_row, lxw_col_t first_col, const char *source, uint8_t source_is_path, lv_str_array_handle column_map, uint8_t write_header, lxw_format header_format, uint32_t *num_rows_out);
+
+/* ============================================================================
+ * Page Setup Functions
+ * ============================================================================ */
+
+/* Bits of lxw_page_setup.present. Only the settings whose bit is set are
+ * applied. */
+enum lxw_page_setup_present {
+    LXW_PAGE_SETUP_ORIENTATION = 1 << 0,
+    LXW_PAGE_SETUP_PAPER = 1 << 1,
+    LXW_PAGE_SETUP_MARGINS = 1 << 2,
+    LXW_PAGE_SETUP_HEADER = 1 << 3,
+    LXW_PAGE_SETUP_FOOTER = 1 << 4,
+    LXW_PAGE_SETUP_PRINT_SCALE = 1 << 5,
+    LXW_PAGE_SETUP_FIT_TO_PAGES = 1 << 6,
+    LXW_PAGE_SETUP_REPEAT_ROWS = 1 << 7,
+    LXW_PAGE_SETUP_REPEAT_COLUMNS = 1 << 8,
+    LXW_PAGE_SETUP_PRINT_AREA = 1 << 9,
+    LXW_PAGE_SETUP_CENTER_HORIZONTALLY = 1 << 10,
+    LXW_PAGE_SETUP_CENTER_VERTICALLY = 1 << 11,
+    LXW_PAGE_SETUP_GRIDLINES = 1 << 12,
+    LXW_PAGE_SETUP_PRINT_HEADINGS = 1 << 13,
+    LXW_PAGE_SETUP_PRINT_ACROSS = 1 << 14,
+    LXW_PAGE_SETUP_BLACK_AND_WHITE = 1 << 15,
+    LXW_PAGE_SETUP_START_PAGE = 1 << 16,
+    LXW_PAGE_SETUP_PAGE_VIEW = 1 << 17
+};
+
+/* Page setup profile (88 bytes, no padding). Negative margins keep the
+ * defaults; header/footer margins of 0 keep the defaults. gridlines is a
+ * worksheet_gridlines() option (0 hide all, 1 screen, 2 print, 3 both). */
+typedef struct lxw_page_setup {
+    double margin_left;
+    double margin_right;
+    double margin_top;
+    double margin_bottom;
+    double header_margin;
+    double footer_margin;
+    uint32_t present;
+    lxw_row_t repeat_first_row;
+    lxw_row_t repeat_last_row;
+    lxw_row_t print_first_row;
+    lxw_row_t print_last_row;
+    uint16_t print_scale;
+    uint16_t fit_width;
+    uint16_t fit_height;
+    uint16_t start_page;
+    lxw_col_t repeat_first_col;
+    lxw_col_t repeat_last_col;
+    lxw_col_t print_first_col;
+    lxw_col_t print_last_col;
+    uint8_t landscape;
+    uint8_t paper_type;
+    uint8_t gridlines;
+    uint8_t reserved;
+} lxw_page_setup;
+
+/* Apply a page setup profile in one call. header and footer are used with
+ * the HEADER/FOOTER bits. Returns the first error; all settings are still
+ * applied. */
+lxw_error worksheet_apply_page_setup_lv(lxw_worksheet worksheet, const lxw_page_setup *setup, const char *header, const char *footer);
+
+/* Apply one profile to an array of worksheet handles (pointer-sized
+ * integers). Zero handles are skipped. */
+lxw_error worksheet_apply_page_setup_many_lv(uintptr_t *worksheets, uint32_t count, const lxw_page_setup *setup, const char *header, const char *footer);
+
+/* ============================================================================
+ * Page Break Functions
+ * ============================================================================ */
+
+/* Set a page break every stride rows from first_row up to last_row (at
+ * most 1023, Excel's limit). num_breaks_out (may be NULL) gets the number
+ * of breaks set. */
+lxw_error worksheet_set_pagebreaks_every_lv(lxw_worksheet worksheet, lxw_row_t first_row, lxw_row_t last_row, uint32_t stride, uint32_t *num_breaks_out);
+
+/* Start a new page wherever the value in worksheet column col changes in
+ * the rows written by the last staging_table_emit_lv() (at most 1023
+ * breaks). num_breaks_out (may be NULL) gets the number set. */
+lxw_error staging_table_set_group_pagebreaks_lv(lxw_staging_table table, lxw_col_t col, uint32_t *num_breaks_out);
+
+/* ============================================================================
+ * Worksheet View Functions
+ * ============================================================================ */
+
+/* Bits of lxw_view_profile.present. */
+enum lxw_view_profile_present {
+    LXW_VIEW_FREEZE_PANES = 1 << 0,
+    LXW_VIEW_SPLIT_PANES = 1 << 1,
+    LXW_VIEW_ZOOM = 1 << 2,
+    LXW_VIEW_GRIDLINES = 1 << 3,
+    LXW_VIEW_TAB_COLOR = 1 << 4,
+    LXW_VIEW_SELECTION = 1 << 5,
+    LXW_VIEW_TOP_LEFT_CELL = 1 << 6,
+    LXW_VIEW_HIDE_ZERO = 1 << 7,
+    LXW_VIEW_RIGHT_TO_LEFT = 1 << 8,
+    LXW_VIEW_PAGE_VIEW = 1 << 9,
+    LXW_VIEW_SELECT = 1 << 10,
+    LXW_VIEW_HIDE = 1 << 11
+};
+
+/* Worksheet view profile (56 bytes, no padding). gridlines is a
+ * worksheet_gridlines() option. tab_color is a LabVIEW RGB color (0 is
+ * black); transparent or system colors leave the tab uncolored. */
+typedef struct lxw_view_profile {
+    double split_vertical;
+    double split_horizontal;
+    uint32_t present;
+    lxw_row_t freeze_row;
+    lxw_row_t select_first_row;
+    lxw_row_t select_last_row;
+    lxw_row_t top_left_row;
+    lxw_color_t tab_color;
+    uint16_t zoom;
+    lxw_col_t freeze_col;
+    lxw_col_t select_first_col;
+    lxw_col_t select_last_col;
+    lxw_col_t top_left_col;
+    uint8_t gridlines;
+    uint8_t reserved[5];
+} lxw_view_profile;
+
+/* Apply a view profile (panes, zoom, gridlines, tab color, selection,
+ * top left cell, ...) in one call. */
+lxw_error worksheet_apply_view_lv(lxw_worksheet worksheet, const lxw_view_profile *view);
+
+/* Apply one view profile to an array of worksheet handles (pointer-sized
+ * integers). Zero handles are skipped. Returns the first error. */
+lxw_error worksheet_apply_view_many_lv(uintptr_t *worksheets, uint32_t count, const lxw_view_profile *view);
+
+/* ============================================================================
+ * Batch Worksheet Functions
+ * ============================================================================ */
+
+/* Add one worksheet per name (LabVIEW string array) in one call. Names are
+ * validated in a single pass, with case-insensitive uniqueness checked by
+ * hashing; empty names get default SheetN names. handles_out (pointer-sized
+ * integers) and errors_out (lxw_error codes) get one entry per name and may
+ * be NULL. Returns the first error; valid names are still added. */
+lxw_error workbook_add_worksheets_lv(lxw_workbook workbook, lv_str_array_handle names, uintptr_t *handles_out, int32_t *errors_out);
+
+/* ============================================================================
+ * Document Property Functions
+ * ============================================================================ */
+
+/* Set the document properties from LabVIEW strings (empty strings leave a
+ * property unset). created is a LabVIEW timestamp in seconds, 0 for the
+ * time the file is written. */
+lxw_error workbook_set_properties_lv(lxw_workbook workbook, const char *title, const char *subject, const char *author, const char *manager, const char *company, const char *category, const char *keywords, const char *comments, const char *status, const char *hyperlink_base, double created);
+
+typedef enum lxw_custom_property_type {
+    LXW_CUSTOM_PROPERTY_STRING = 0,
+    LXW_CUSTOM_PROPERTY_NUMBER,
+    LXW_CUSTOM_PROPERTY_INTEGER,
+    LXW_CUSTOM_PROPERTY_BOOLEAN,
+    LXW_CUSTOM_PROPERTY_DATETIME
+} lxw_custom_property_type;
+
+/* Set many custom properties in one call. names and values are LabVIEW
+ * string arrays of the same length; types (U8 array) gives each value's
+ * lxw_custom_property_type. Non-string values are text: "3.5", "42",
+ * "true"/"false"/"1"/"0", "2024-05-01 13:45:00" or "2024-05-01".
+ * errors_out (I32 array, may be NULL) gets a code per property. Returns
+ * the first error; the other properties are still set. */
+lxw_error workbook_set_custom_properties_lv(lxw_workbook workbook, lv_str_array_handle names, lv_str_array_handle values, const uint8_t *types, int32_t *errors_out);
+
 #endif /* __LIBXLSXWRITER_LV_H__ */
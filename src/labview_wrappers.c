@@ -17,6 +17,8 @@
 #include <windows.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <math.h>
 
 /* Handle type for LabVIEW compatibility (32-bit on x86, 64-bit handles need uintptr_t) */
 typedef uintptr_t lxw_handle;
@@ -74,6 +76,13 @@ ansi_to_utf8(const char *ansi_str)
 /* On non-Windows, assume strings are already UTF-8 */
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 static char *
 ansi_to_utf8(const char *str)
@@ -84,6 +93,369 @@ ansi_to_utf8(const char *str)
 }
 #endif
 
+/* ============================================================================
+ * LabVIEW string array and arena helpers
+ * ============================================================================ */
+
+/*
+ * Minimal mirrors of the LabVIEW string handle types from extcode.h.
+ * Functions taking a native LabVIEW string array expect the Call Library
+ * Function Node parameter to be configured as "Adapt to Type" with
+ * "Handles by Value". LabVIEW strings are counted and not NUL-terminated.
+ */
+typedef struct lv_str {
+    int32_t cnt;
+    char str[1];
+} lv_str, **lv_str_handle;
+
+typedef struct lv_str_array {
+    int32_t dim_size;
+    lv_str_handle elt[1];
+} lv_str_array, **lv_str_array_handle;
+
+static int32_t
+lv_str_array_size(lv_str_array_handle array)
+{
+    if (!array || !*array || (*array)->dim_size < 0)
+        return 0;
+    return (*array)->dim_size;
+}
+
+/* Get the data and length of element i. Empty or NULL handles give len 0. */
+static const char *
+lv_str_array_get(lv_str_array_handle array, int32_t i, int32_t *len)
+{
+    lv_str_handle handle = (*array)->elt[i];
+
+    if (!handle || !*handle || (*handle)->cnt <= 0) {
+        *len = 0;
+        return "";
+    }
+
+    *len = (*handle)->cnt;
+    return (*handle)->str;
+}
+
+/*
+ * Bump allocator used to transcode and hold many small strings with a
+ * handful of mallocs. Everything allocated from an arena is released
+ * together by arena_free().
+ */
+#define LV_ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct lv_arena_block {
+    struct lv_arena_block *next;
+    size_t size;
+    size_t used;
+} lv_arena_block;
+
+#define LV_ARENA_HEADER_SIZE ((sizeof(lv_arena_block) + 7) & ~(size_t) 7)
+
+typedef struct lv_arena {
+    lv_arena_block *blocks;
+
+    /* Reusable transcoding buffers. */
+    char *scratch;
+    size_t scratch_size;
+#ifdef _WIN32
+    wchar_t *wide;
+    int wide_size;
+#endif
+} lv_arena;
+
+static void *
+arena_alloc(lv_arena *arena, size_t size)
+{
+    lv_arena_block *block = arena->blocks;
+    char *ptr;
+
+    size = (size + 7) & ~(size_t) 7;
+
+    if (!block || block->size - block->used < size) {
+        size_t block_size =
+            size > LV_ARENA_BLOCK_SIZE ? size : LV_ARENA_BLOCK_SIZE;
+
+        block = (lv_arena_block *) malloc(LV_ARENA_HEADER_SIZE + block_size);
+        if (!block)
+            return NULL;
+
+        block->size = block_size;
+        block->used = 0;
+
+        /* Keep a partly used current block at the head for small requests. */
+        if (arena->blocks && size > LV_ARENA_BLOCK_SIZE / 4) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        }
+        else {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+
+    ptr = (char *) block + LV_ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    return ptr;
+}
+
+static char *
+arena_strndup(lv_arena *arena, const char *str, size_t len)
+{
+    char *copy = (char *) arena_alloc(arena, len + 1);
+    if (!copy)
+        return NULL;
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+static void
+arena_free(lv_arena *arena)
+{
+    lv_arena_block *block = arena->blocks;
+
+    while (block) {
+        lv_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(arena->scratch);
+#ifdef _WIN32
+    free(arena->wide);
+#endif
+    memset(arena, 0, sizeof(lv_arena));
+}
+
+static int
+arena_reserve_scratch(lv_arena *arena, size_t size)
+{
+    char *scratch;
+
+    if (size <= arena->scratch_size)
+        return 1;
+
+    scratch = (char *) realloc(arena->scratch, size);
+    if (!scratch)
+        return 0;
+
+    arena->scratch = scratch;
+    arena->scratch_size = size;
+    return 1;
+}
+
+/*
+ * Convert a counted ANSI string to a NUL-terminated UTF-8 string in the
+ * arena's scratch buffer. The result is only valid until the next call.
+ * Pure ASCII input, the common case, is copied without conversion.
+ */
+static const char *
+arena_scratch_utf8(lv_arena *arena, const char *str, int32_t len,
+                   size_t *utf8_len)
+{
+    int32_t i;
+
+    for (i = 0; i < len; i++) {
+        if ((unsigned char) str[i] >= 0x80)
+            break;
+    }
+
+    if (i == len) {
+        if (!arena_reserve_scratch(arena, (size_t) len + 1))
+            return NULL;
+
+        memcpy(arena->scratch, str, len);
+        arena->scratch[len] = '\0';
+        *utf8_len = len;
+        return arena->scratch;
+    }
+
+#ifdef _WIN32
+    {
+        int wide_len, out_len;
+
+        wide_len = MultiByteToWideChar(CP_ACP, 0, str, len, NULL, 0);
+        if (wide_len <= 0)
+            return NULL;
+
+        if (wide_len > arena->wide_size) {
+            wchar_t *wide = (wchar_t *) realloc(arena->wide,
+                                                wide_len * sizeof(wchar_t));
+            if (!wide)
+                return NULL;
+
+            arena->wide = wide;
+            arena->wide_size = wide_len;
+        }
+
+        MultiByteToWideChar(CP_ACP, 0, str, len, arena->wide, wide_len);
+
+        out_len = WideCharToMultiByte(CP_UTF8, 0, arena->wide, wide_len,
+                                      NULL, 0, NULL, NULL);
+        if (out_len <= 0 || !arena_reserve_scratch(arena, out_len + 1))
+            return NULL;
+
+        WideCharToMultiByte(CP_UTF8, 0, arena->wide, wide_len,
+                            arena->scratch, out_len, NULL, NULL);
+        arena->scratch[out_len] = '\0';
+        *utf8_len = out_len;
+        return arena->scratch;
+    }
+#else
+    if (!arena_reserve_scratch(arena, (size_t) len + 1))
+        return NULL;
+
+    memcpy(arena->scratch, str, len);
+    arena->scratch[len] = '\0';
+    *utf8_len = len;
+    return arena->scratch;
+#endif
+}
+
+/* Convert a counted ANSI string to a UTF-8 copy owned by the arena. */
+static char *
+arena_utf8(lv_arena *arena, const char *str, int32_t len)
+{
+    size_t utf8_len;
+    const char *utf8 = arena_scratch_utf8(arena, str, len, &utf8_len);
+
+    if (!utf8)
+        return NULL;
+
+    return arena_strndup(arena, utf8, utf8_len);
+}
+
+/*
+ * Interning table of distinct strings, used to dictionary-encode string
+ * data. Ids are dense and assigned in insertion order.
+ */
+typedef struct lv_dict {
+    char **strings;
+    uint32_t *hashes;
+    uint32_t count;
+    uint32_t capacity;
+
+    /* Open addressing table of id + 1, 0 marks an empty slot. */
+    uint32_t *slots;
+    uint32_t num_slots;
+} lv_dict;
+
+#define LV_DICT_NOT_FOUND 0xFFFFFFFFu
+
+static uint32_t
+dict_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static uint32_t
+dict_find(const lv_dict *dict, const char *str, size_t len, uint32_t hash)
+{
+    uint32_t mask, slot;
+
+    if (!dict->num_slots)
+        return LV_DICT_NOT_FOUND;
+
+    mask = dict->num_slots - 1;
+
+    for (slot = hash & mask; dict->slots[slot]; slot = (slot + 1) & mask) {
+        uint32_t id = dict->slots[slot] - 1;
+
+        if (dict->hashes[id] == hash
+            && strncmp(dict->strings[id], str, len) == 0
+            && dict->strings[id][len] == '\0')
+            return id;
+    }
+
+    return LV_DICT_NOT_FOUND;
+}
+
+static int
+dict_grow(lv_dict *dict)
+{
+    uint32_t num_slots = dict->num_slots ? dict->num_slots * 2 : 64;
+    uint32_t capacity = num_slots / 2;
+    char **strings;
+    uint32_t *hashes;
+    uint32_t *slots;
+    uint32_t i;
+
+    strings = (char **) realloc(dict->strings, capacity * sizeof(char *));
+    if (!strings)
+        return 0;
+    dict->strings = strings;
+
+    hashes = (uint32_t *) realloc(dict->hashes, capacity * sizeof(uint32_t));
+    if (!hashes)
+        return 0;
+    dict->hashes = hashes;
+
+    slots = (uint32_t *) calloc(num_slots, sizeof(uint32_t));
+    if (!slots)
+        return 0;
+
+    for (i = 0; i < dict->count; i++) {
+        uint32_t slot = dict->hashes[i] & (num_slots - 1);
+
+        while (slots[slot])
+            slot = (slot + 1) & (num_slots - 1);
+        slots[slot] = i + 1;
+    }
+
+    free(dict->slots);
+    dict->slots = slots;
+    dict->num_slots = num_slots;
+    dict->capacity = capacity;
+    return 1;
+}
+
+/* Return the id of a UTF-8 string, adding an arena copy if it is new. */
+static uint32_t
+dict_intern(lv_dict *dict, lv_arena *arena, const char *str, size_t len)
+{
+    uint32_t hash = dict_hash(str, len);
+    uint32_t id = dict_find(dict, str, len, hash);
+    uint32_t slot;
+
+    if (id != LV_DICT_NOT_FOUND)
+        return id;
+
+    if (dict->count == dict->capacity && !dict_grow(dict))
+        return LV_DICT_NOT_FOUND;
+
+    id = dict->count;
+    dict->strings[id] = arena_strndup(arena, str, len);
+    if (!dict->strings[id])
+        return LV_DICT_NOT_FOUND;
+
+    dict->hashes[id] = hash;
+    dict->count++;
+
+    for (slot = hash & (dict->num_slots - 1); dict->slots[slot];
+         slot = (slot + 1) & (dict->num_slots - 1));
+    dict->slots[slot] = id + 1;
+
+    return id;
+}
+
+static void
+dict_free(lv_dict *dict)
+{
+    free(dict->strings);
+    free(dict->hashes);
+    free(dict->slots);
+    memset(dict, 0, sizeof(lv_dict));
+}
+
 /* ============================================================================
  * Worksheet write functions
  * ============================================================================ */
@@ -201,6 +573,124 @@ worksheet_insert_textbox_opt_lv(lxw_worksheet *worksheet, lxw_row_t row,
     return err;
 }
 
+/* One rich string cell: its position, how many consecutive fragments it
+ * uses and an index into the format palette for the cell (out of range
+ * for none). */
+typedef struct lxw_rich_cell {
+    lxw_row_t row;
+    uint32_t num_fragments;
+    lxw_col_t col;
+    uint16_t format_index;
+} lxw_rich_cell;
+
+/*
+ * Write many rich strings in one call. fragments is a LabVIEW string array
+ * holding the fragments of every cell in order, and fragment_formats (may
+ * be NULL) holds a format palette index for each fragment, out of range
+ * for the default format. Empty fragments are skipped, and a cell left
+ * with a single fragment is written as a plain string in that fragment's
+ * format. The tuples and UTF-8 text are built in one arena.
+ */
+lxw_error
+worksheet_write_rich_strings_lv(lxw_worksheet *worksheet,
+                                const lxw_rich_cell *cells,
+                                uint32_t num_cells,
+                                lv_str_array_handle fragments,
+                                const uint16_t *fragment_formats,
+                                const uintptr_t *format_palette,
+                                uint32_t palette_size)
+{
+    lv_arena arena = { 0 };
+    int32_t num_fragments = lv_str_array_size(fragments);
+    lxw_rich_string_tuple *tuples = NULL;
+    lxw_rich_string_tuple **tuple_ptrs = NULL;
+    uint32_t max_fragments = 0;
+    uint32_t next = 0;
+    uint32_t i;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!worksheet || !cells || num_cells == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (!format_palette)
+        palette_size = 0;
+
+    /* Validate the fragment counts and size the tuple arrays once. */
+    for (i = 0; i < num_cells; i++) {
+        if (cells[i].num_fragments > (uint32_t) num_fragments - next)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+
+        next += cells[i].num_fragments;
+        if (cells[i].num_fragments > max_fragments)
+            max_fragments = cells[i].num_fragments;
+    }
+
+    if (max_fragments) {
+        tuples = (lxw_rich_string_tuple *)
+            arena_alloc(&arena, max_fragments * sizeof(lxw_rich_string_tuple));
+        tuple_ptrs = (lxw_rich_string_tuple **)
+            arena_alloc(&arena, (max_fragments + 1) *
+                        sizeof(lxw_rich_string_tuple *));
+        if (!tuples || !tuple_ptrs) {
+            arena_free(&arena);
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+    }
+
+    next = 0;
+    for (i = 0; i < num_cells && !err; i++) {
+        const lxw_rich_cell *cell = &cells[i];
+        lxw_format *cell_format = NULL;
+        uint32_t count = 0;
+        uint32_t j;
+
+        if (cell->format_index < palette_size)
+            cell_format = (lxw_format *) format_palette[cell->format_index];
+
+        for (j = 0; j < cell->num_fragments; j++, next++) {
+            lxw_rich_string_tuple *tuple = &tuples[count];
+            uint16_t format_index;
+            int32_t len;
+            const char *str = lv_str_array_get(fragments, (int32_t) next,
+                                               &len);
+
+            if (!len)
+                continue;
+
+            tuple->string = arena_utf8(&arena, str, len);
+            if (!tuple->string) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                break;
+            }
+
+            format_index = fragment_formats ? fragment_formats[next]
+                : UINT16_MAX;
+            tuple->format = format_index < palette_size
+                ? (lxw_format *) format_palette[format_index] : NULL;
+
+            tuple_ptrs[count++] = tuple;
+        }
+
+        if (err || count == 0)
+            continue;
+
+        if (count == 1) {
+            err = worksheet_write_string(worksheet, cell->row, cell->col,
+                                         tuples[0].string,
+                                         tuples[0].format ? tuples[0].format
+                                         : cell_format);
+        }
+        else {
+            tuple_ptrs[count] = NULL;
+            err = worksheet_write_rich_string(worksheet, cell->row, cell->col,
+                                              tuple_ptrs, cell_format);
+        }
+    }
+
+    arena_free(&arena);
+    return err;
+}
+
 /* ============================================================================
  * Chart functions
  * ============================================================================ */
@@ -322,109 +812,651 @@ chart_title_set_name_range_lv(lxw_chart *chart, const char *sheetname,
     free(utf8);
 }
 
-/* ============================================================================
- * Format functions
- * ============================================================================ */
-
-void
-format_set_font_name_lv(lxw_format *format, const char *font_name)
-{
-    char *utf8 = ansi_to_utf8(font_name);
-    format_set_font_name(format, utf8 ? utf8 : font_name);
-    free(utf8);
-}
-
+/*
+ * Omit the cached copies of the referenced data that are normally stored
+ * with each series range (numCache/strCache); Excel recomputes them when
+ * the file is opened. For very long series this roughly halves the chart
+ * XML and skips reading the data back at workbook_close(). Applies to the
+ * series already added to the chart, so call it after adding them.
+ */
 void
-format_set_num_format_lv(lxw_format *format, const char *num_format)
+chart_set_ignore_cache_lv(lxw_chart *chart, uint8_t ignore_cache)
 {
-    char *utf8 = ansi_to_utf8(num_format);
-    format_set_num_format(format, utf8 ? utf8 : num_format);
-    free(utf8);
-}
+    lxw_chart_series *series;
 
-/* ============================================================================
- * Workbook functions
- * ============================================================================ */
+    if (!chart)
+        return;
 
-lxw_worksheet *
-workbook_add_worksheet_lv(lxw_workbook *workbook, const char *sheetname)
-{
-    /* Pass NULL to get default Sheet1, Sheet2, etc. names */
-    if (!sheetname || !*sheetname) {
-        return workbook_add_worksheet(workbook, NULL);
+    STAILQ_FOREACH(series, chart->series_list, list_pointers) {
+        if (series->categories)
+            series->categories->ignore_cache = ignore_cache;
+        if (series->values)
+            series->values->ignore_cache = ignore_cache;
+        if (series->title.range)
+            series->title.range->ignore_cache = ignore_cache;
     }
-    char *utf8 = ansi_to_utf8(sheetname);
-    lxw_worksheet *ws =
-        workbook_add_worksheet(workbook, utf8 ? utf8 : sheetname);
-    free(utf8);
-    return ws;
 }
 
-lxw_chartsheet *
-workbook_add_chartsheet_lv(lxw_workbook *workbook, const char *sheetname)
+/* Axis accessors, since LabVIEW can't read the axis pointers from the
+ * lxw_chart struct. */
+lxw_chart_axis *
+chart_get_x_axis(lxw_chart *chart)
 {
-    /* Pass NULL to get default Chart1, Chart2, etc. names */
-    if (!sheetname || !*sheetname) {
-        return workbook_add_chartsheet(workbook, NULL);
-    }
-    char *utf8 = ansi_to_utf8(sheetname);
-    lxw_chartsheet *cs =
-        workbook_add_chartsheet(workbook, utf8 ? utf8 : sheetname);
-    free(utf8);
-    return cs;
+    return chart ? chart->x_axis : NULL;
 }
 
-lxw_error
-workbook_define_name_lv(lxw_workbook *workbook, const char *name,
-                        const char *formula)
+lxw_chart_axis *
+chart_get_y_axis(lxw_chart *chart)
 {
-    char *utf8_name = ansi_to_utf8(name);
-    char *utf8_formula = ansi_to_utf8(formula);
-    lxw_error err = workbook_define_name(workbook,
-                                         utf8_name ? utf8_name : name,
-                                         utf8_formula ? utf8_formula :
-                                         formula);
-    free(utf8_name);
-    free(utf8_formula);
-    return err;
+    return chart ? chart->y_axis : NULL;
 }
 
-lxw_worksheet *
-workbook_get_worksheet_by_name_lv(lxw_workbook *workbook, const char *name)
+lxw_chart_axis *
+chart_get_y2_axis(lxw_chart *chart)
 {
-    char *utf8 = ansi_to_utf8(name);
-    lxw_worksheet *ws =
-        workbook_get_worksheet_by_name(workbook, utf8 ? utf8 : name);
-    free(utf8);
-    return ws;
+    return chart ? chart->y2_axis : NULL;
 }
 
-lxw_chartsheet *
-workbook_get_chartsheet_by_name_lv(lxw_workbook *workbook, const char *name)
-{
-    char *utf8 = ansi_to_utf8(name);
-    lxw_chartsheet *cs =
-        workbook_get_chartsheet_by_name(workbook, utf8 ? utf8 : name);
-    free(utf8);
-    return cs;
-}
+/* Bits of lxw_axis_spec.present, one per group of settings. */
+enum lxw_axis_spec_present {
+    LXW_AXIS_SPEC_MIN = 1 << 0,
+    LXW_AXIS_SPEC_MAX = 1 << 1,
+    LXW_AXIS_SPEC_MAJOR_UNIT = 1 << 2,
+    LXW_AXIS_SPEC_MINOR_UNIT = 1 << 3,
+    LXW_AXIS_SPEC_LOG_BASE = 1 << 4,
+    LXW_AXIS_SPEC_CROSSING = 1 << 5,
+    LXW_AXIS_SPEC_POSITION = 1 << 6,
+    LXW_AXIS_SPEC_LABEL_POSITION = 1 << 7,
+    LXW_AXIS_SPEC_LABEL_ALIGN = 1 << 8,
+    LXW_AXIS_SPEC_TICK_MARKS = 1 << 9,
+    LXW_AXIS_SPEC_INTERVAL_UNIT = 1 << 10,
+    LXW_AXIS_SPEC_INTERVAL_TICK = 1 << 11,
+    LXW_AXIS_SPEC_DISPLAY_UNITS = 1 << 12,
+    LXW_AXIS_SPEC_MAJOR_GRIDLINES = 1 << 13,
+    LXW_AXIS_SPEC_MINOR_GRIDLINES = 1 << 14,
+    LXW_AXIS_SPEC_NUM_FONT = 1 << 15,
+    LXW_AXIS_SPEC_NAME_FONT = 1 << 16,
+    LXW_AXIS_SPEC_LINE = 1 << 17,
+    LXW_AXIS_SPEC_REVERSE = 1 << 18,
+    LXW_AXIS_SPEC_OFF = 1 << 19,
+    LXW_AXIS_SPEC_NAME = 1 << 20,
+    LXW_AXIS_SPEC_NUM_FORMAT = 1 << 21
+};
 
-lxw_error
-workbook_validate_sheet_name_lv(lxw_workbook *workbook, const char *sheetname)
+/* lxw_axis_spec.crossing_type values. */
+enum lxw_axis_spec_crossing {
+    LXW_AXIS_SPEC_CROSSING_VALUE = 0,
+    LXW_AXIS_SPEC_CROSSING_MIN,
+    LXW_AXIS_SPEC_CROSSING_MAX
+};
+
+/*
+ * A complete axis configuration. Fields are ordered by size with explicit
+ * padding so that the layout is the same with LabVIEW's packed 32-bit
+ * clusters and with natural alignment. Colors of 0 leave the default.
+ */
+typedef struct lxw_axis_spec {
+    double min;
+    double max;
+    double major_unit;
+    double minor_unit;
+    double crossing;
+    double num_font_size;
+    double name_font_size;
+    double line_width;
+    double major_gridlines_width;
+    double minor_gridlines_width;
+    uint32_t present;
+    int32_t num_font_rotation;
+    lxw_color_t num_font_color;
+    lxw_color_t name_font_color;
+    lxw_color_t line_color;
+    lxw_color_t major_gridlines_color;
+    lxw_color_t minor_gridlines_color;
+    uint16_t log_base;
+    uint16_t interval_unit;
+    uint16_t interval_tick;
+    uint8_t crossing_type;
+    uint8_t position;
+    uint8_t label_position;
+    uint8_t label_align;
+    uint8_t major_tick_mark;
+    uint8_t minor_tick_mark;
+    uint8_t display_units;
+    uint8_t display_units_visible;
+    uint8_t major_gridlines_visible;
+    uint8_t minor_gridlines_visible;
+    uint8_t major_gridlines_dash_type;
+    uint8_t minor_gridlines_dash_type;
+    uint8_t line_none;
+    uint8_t line_dash_type;
+    uint8_t num_font_bold;
+    uint8_t num_font_italic;
+    uint8_t name_font_bold;
+    uint8_t name_font_italic;
+    uint8_t reserved[4];
+} lxw_axis_spec;
+
+static void
+axis_set_gridlines(lxw_chart_axis *axis, uint8_t major, uint8_t visible,
+                   lxw_color_t color, double width, uint8_t dash_type)
 {
-    char *utf8 = ansi_to_utf8(sheetname);
-    lxw_error err =
-        workbook_validate_sheet_name(workbook, utf8 ? utf8 : sheetname);
-    free(utf8);
-    return err;
+    lxw_chart_line line = { 0 };
+
+    if (major)
+        chart_axis_major_gridlines_set_visible(axis, visible);
+    else
+        chart_axis_minor_gridlines_set_visible(axis, visible);
+
+    if (!visible || (!color && width <= 0 && !dash_type))
+        return;
+
+    line.color = color;
+    line.width = (float) width;
+    line.dash_type = dash_type;
+
+    if (major)
+        chart_axis_major_gridlines_set_line(axis, &line);
+    else
+        chart_axis_minor_gridlines_set_line(axis, &line);
 }
 
-lxw_error
-workbook_set_custom_property_string_lv(lxw_workbook *workbook,
-                                       const char *name, const char *value)
+/* Apply an axis spec. The strings are already UTF-8. */
+static void
+axis_configure(lxw_chart_axis *axis, const lxw_axis_spec *spec,
+               const char *name, const char *num_format)
 {
-    char *utf8_name = ansi_to_utf8(name);
-    char *utf8_value = ansi_to_utf8(value);
+    uint32_t present = spec->present;
+
+    if ((present & LXW_AXIS_SPEC_NAME) && name)
+        chart_axis_set_name(axis, name);
+
+    if ((present & LXW_AXIS_SPEC_NUM_FORMAT) && num_format)
+        chart_axis_set_num_format(axis, num_format);
+
+    if (present & LXW_AXIS_SPEC_MIN)
+        chart_axis_set_min(axis, spec->min);
+
+    if (present & LXW_AXIS_SPEC_MAX)
+        chart_axis_set_max(axis, spec->max);
+
+    if (present & LXW_AXIS_SPEC_MAJOR_UNIT)
+        chart_axis_set_major_unit(axis, spec->major_unit);
+
+    if (present & LXW_AXIS_SPEC_MINOR_UNIT)
+        chart_axis_set_minor_unit(axis, spec->minor_unit);
+
+    if (present & LXW_AXIS_SPEC_LOG_BASE)
+        chart_axis_set_log_base(axis, spec->log_base);
+
+    if (present & LXW_AXIS_SPEC_CROSSING) {
+        if (spec->crossing_type == LXW_AXIS_SPEC_CROSSING_MIN)
+            chart_axis_set_crossing_min(axis);
+        else if (spec->crossing_type == LXW_AXIS_SPEC_CROSSING_MAX)
+            chart_axis_set_crossing_max(axis);
+        else
+            chart_axis_set_crossing(axis, spec->crossing);
+    }
+
+    if (present & LXW_AXIS_SPEC_POSITION)
+        chart_axis_set_position(axis, spec->position);
+
+    if (present & LXW_AXIS_SPEC_LABEL_POSITION)
+        chart_axis_set_label_position(axis, spec->label_position);
+
+    if (present & LXW_AXIS_SPEC_LABEL_ALIGN)
+        chart_axis_set_label_align(axis, spec->label_align);
+
+    if (present & LXW_AXIS_SPEC_TICK_MARKS) {
+        chart_axis_set_major_tick_mark(axis, spec->major_tick_mark);
+        chart_axis_set_minor_tick_mark(axis, spec->minor_tick_mark);
+    }
+
+    if (present & LXW_AXIS_SPEC_INTERVAL_UNIT)
+        chart_axis_set_interval_unit(axis, spec->interval_unit);
+
+    if (present & LXW_AXIS_SPEC_INTERVAL_TICK)
+        chart_axis_set_interval_tick(axis, spec->interval_tick);
+
+    if (present & LXW_AXIS_SPEC_DISPLAY_UNITS) {
+        chart_axis_set_display_units(axis, spec->display_units);
+        chart_axis_set_display_units_visible(axis,
+                                             spec->display_units_visible);
+    }
+
+    if (present & LXW_AXIS_SPEC_MAJOR_GRIDLINES)
+        axis_set_gridlines(axis, 1, spec->major_gridlines_visible,
+                           spec->major_gridlines_color,
+                           spec->major_gridlines_width,
+                           spec->major_gridlines_dash_type);
+
+    if (present & LXW_AXIS_SPEC_MINOR_GRIDLINES)
+        axis_set_gridlines(axis, 0, spec->minor_gridlines_visible,
+                           spec->minor_gridlines_color,
+                           spec->minor_gridlines_width,
+                           spec->minor_gridlines_dash_type);
+
+    if (present & LXW_AXIS_SPEC_NUM_FONT) {
+        lxw_chart_font font = { 0 };
+
+        font.size = spec->num_font_size;
+        font.bold = spec->num_font_bold;
+        font.italic = spec->num_font_italic;
+        font.rotation = spec->num_font_rotation;
+        font.color = spec->num_font_color;
+        chart_axis_set_num_font(axis, &font);
+    }
+
+    if (present & LXW_AXIS_SPEC_NAME_FONT) {
+        lxw_chart_font font = { 0 };
+
+        font.size = spec->name_font_size;
+        font.bold = spec->name_font_bold;
+        font.italic = spec->name_font_italic;
+        font.color = spec->name_font_color;
+        chart_axis_set_name_font(axis, &font);
+    }
+
+    if (present & LXW_AXIS_SPEC_LINE) {
+        lxw_chart_line line = { 0 };
+
+        line.color = spec->line_color;
+        line.none = spec->line_none;
+        line.width = (float) spec->line_width;
+        line.dash_type = spec->line_dash_type;
+        chart_axis_set_line(axis, &line);
+    }
+
+    if (present & LXW_AXIS_SPEC_REVERSE)
+        chart_axis_set_reverse(axis);
+
+    if (present & LXW_AXIS_SPEC_OFF)
+        chart_axis_off(axis);
+}
+
+/*
+ * Apply every setting of an axis spec whose bit is set in spec->present.
+ * name and num_format are passed separately as LabVIEW strings and are
+ * used with the LXW_AXIS_SPEC_NAME and LXW_AXIS_SPEC_NUM_FORMAT bits.
+ */
+void
+chart_axis_configure_lv(lxw_chart_axis *axis, const lxw_axis_spec *spec,
+                        const char *name, const char *num_format)
+{
+    char *utf8_name;
+    char *utf8_num_format;
+
+    if (!axis || !spec)
+        return;
+
+    utf8_name = ansi_to_utf8(name);
+    utf8_num_format = ansi_to_utf8(num_format);
+
+    axis_configure(axis, spec, utf8_name ? utf8_name : name,
+                   utf8_num_format ? utf8_num_format : num_format);
+
+    free(utf8_name);
+    free(utf8_num_format);
+}
+
+/* Bits of lxw_series_spec.present, one per group of settings. */
+enum lxw_series_spec_present {
+    LXW_SERIES_SPEC_LINE = 1 << 0,
+    LXW_SERIES_SPEC_FILL = 1 << 1,
+    LXW_SERIES_SPEC_INVERT_IF_NEGATIVE = 1 << 2,
+    LXW_SERIES_SPEC_SMOOTH = 1 << 3,
+    LXW_SERIES_SPEC_MARKER_TYPE = 1 << 4,
+    LXW_SERIES_SPEC_MARKER_SIZE = 1 << 5,
+    LXW_SERIES_SPEC_MARKER_LINE = 1 << 6,
+    LXW_SERIES_SPEC_MARKER_FILL = 1 << 7,
+    LXW_SERIES_SPEC_LABELS = 1 << 8,
+    LXW_SERIES_SPEC_LABELS_POSITION = 1 << 9,
+    LXW_SERIES_SPEC_LABELS_SEPARATOR = 1 << 10,
+    LXW_SERIES_SPEC_LABELS_LEADER_LINE = 1 << 11,
+    LXW_SERIES_SPEC_LABELS_LEGEND = 1 << 12,
+    LXW_SERIES_SPEC_LABELS_PERCENTAGE = 1 << 13,
+    LXW_SERIES_SPEC_LABELS_FONT = 1 << 14,
+    LXW_SERIES_SPEC_LABELS_FILL = 1 << 15,
+    LXW_SERIES_SPEC_LABELS_NUM_FORMAT = 1 << 16,
+    LXW_SERIES_SPEC_TRENDLINE = 1 << 17,
+    LXW_SERIES_SPEC_TRENDLINE_FORECAST = 1 << 18,
+    LXW_SERIES_SPEC_TRENDLINE_EQUATION = 1 << 19,
+    LXW_SERIES_SPEC_TRENDLINE_R_SQUARED = 1 << 20,
+    LXW_SERIES_SPEC_TRENDLINE_INTERCEPT = 1 << 21,
+    LXW_SERIES_SPEC_TRENDLINE_LINE = 1 << 22,
+    LXW_SERIES_SPEC_TRENDLINE_NAME = 1 << 23
+};
+
+/*
+ * A complete series style. Laid out like lxw_axis_spec: ordered by size
+ * with explicit padding so packed and natural layouts agree.
+ */
+typedef struct lxw_series_spec {
+    double line_width;
+    double marker_line_width;
+    double labels_font_size;
+    double trendline_line_width;
+    double trendline_forward;
+    double trendline_backward;
+    double trendline_intercept;
+    uint32_t present;
+    int32_t labels_font_rotation;
+    lxw_color_t line_color;
+    lxw_color_t fill_color;
+    lxw_color_t marker_line_color;
+    lxw_color_t marker_fill_color;
+    lxw_color_t labels_font_color;
+    lxw_color_t labels_fill_color;
+    lxw_color_t trendline_line_color;
+    uint8_t line_none;
+    uint8_t line_dash_type;
+    uint8_t line_transparency;
+    uint8_t fill_none;
+    uint8_t fill_transparency;
+    uint8_t smooth;
+    uint8_t marker_type;
+    uint8_t marker_size;
+    uint8_t marker_line_none;
+    uint8_t marker_fill_none;
+    uint8_t labels_show_name;
+    uint8_t labels_show_category;
+    uint8_t labels_show_value;
+    uint8_t labels_position;
+    uint8_t labels_separator;
+    uint8_t labels_font_bold;
+    uint8_t labels_font_italic;
+    uint8_t labels_fill_none;
+    uint8_t trendline_type;
+    uint8_t trendline_value;
+    uint8_t trendline_line_dash_type;
+    uint8_t reserved[7];
+} lxw_series_spec;
+
+/* Apply a series spec. The strings are already UTF-8. */
+static void
+series_configure(lxw_chart_series *series, const lxw_series_spec *spec,
+                 const char *labels_num_format, const char *trendline_name)
+{
+    uint32_t present = spec->present;
+
+    if (present & LXW_SERIES_SPEC_LINE) {
+        lxw_chart_line line = { 0 };
+
+        line.color = spec->line_color;
+        line.none = spec->line_none;
+        line.width = (float) spec->line_width;
+        line.dash_type = spec->line_dash_type;
+        line.transparency = spec->line_transparency;
+        chart_series_set_line(series, &line);
+    }
+
+    if (present & LXW_SERIES_SPEC_FILL) {
+        lxw_chart_fill fill = { 0 };
+
+        fill.color = spec->fill_color;
+        fill.none = spec->fill_none;
+        fill.transparency = spec->fill_transparency;
+        chart_series_set_fill(series, &fill);
+    }
+
+    if (present & LXW_SERIES_SPEC_INVERT_IF_NEGATIVE)
+        chart_series_set_invert_if_negative(series);
+
+    if (present & LXW_SERIES_SPEC_SMOOTH)
+        chart_series_set_smooth(series, spec->smooth);
+
+    if (present & LXW_SERIES_SPEC_MARKER_TYPE)
+        chart_series_set_marker_type(series, spec->marker_type);
+
+    if (present & LXW_SERIES_SPEC_MARKER_SIZE)
+        chart_series_set_marker_size(series, spec->marker_size);
+
+    if (present & LXW_SERIES_SPEC_MARKER_LINE) {
+        lxw_chart_line line = { 0 };
+
+        line.color = spec->marker_line_color;
+        line.none = spec->marker_line_none;
+        line.width = (float) spec->marker_line_width;
+        chart_series_set_marker_line(series, &line);
+    }
+
+    if (present & LXW_SERIES_SPEC_MARKER_FILL) {
+        lxw_chart_fill fill = { 0 };
+
+        fill.color = spec->marker_fill_color;
+        fill.none = spec->marker_fill_none;
+        chart_series_set_marker_fill(series, &fill);
+    }
+
+    if (present & LXW_SERIES_SPEC_LABELS) {
+        if (spec->labels_show_name || spec->labels_show_category
+            || spec->labels_show_value)
+            chart_series_set_labels_options(series, spec->labels_show_name,
+                                            spec->labels_show_category,
+                                            spec->labels_show_value);
+        else
+            chart_series_set_labels(series);
+    }
+
+    if (present & LXW_SERIES_SPEC_LABELS_POSITION)
+        chart_series_set_labels_position(series, spec->labels_position);
+
+    if (present & LXW_SERIES_SPEC_LABELS_SEPARATOR)
+        chart_series_set_labels_separator(series, spec->labels_separator);
+
+    if (present & LXW_SERIES_SPEC_LABELS_LEADER_LINE)
+        chart_series_set_labels_leader_line(series);
+
+    if (present & LXW_SERIES_SPEC_LABELS_LEGEND)
+        chart_series_set_labels_legend(series);
+
+    if (present & LXW_SERIES_SPEC_LABELS_PERCENTAGE)
+        chart_series_set_labels_percentage(series);
+
+    if (present & LXW_SERIES_SPEC_LABELS_FONT) {
+        lxw_chart_font font = { 0 };
+
+        font.size = spec->labels_font_size;
+        font.bold = spec->labels_font_bold;
+        font.italic = spec->labels_font_italic;
+        font.rotation = spec->labels_font_rotation;
+        font.color = spec->labels_font_color;
+        chart_series_set_labels_font(series, &font);
+    }
+
+    if (present & LXW_SERIES_SPEC_LABELS_FILL) {
+        lxw_chart_fill fill = { 0 };
+
+        fill.color = spec->labels_fill_color;
+        fill.none = spec->labels_fill_none;
+        chart_series_set_labels_fill(series, &fill);
+    }
+
+    if ((present & LXW_SERIES_SPEC_LABELS_NUM_FORMAT) && labels_num_format)
+        chart_series_set_labels_num_format(series, labels_num_format);
+
+    if (present & LXW_SERIES_SPEC_TRENDLINE)
+        chart_series_set_trendline(series, spec->trendline_type,
+                                   spec->trendline_value);
+
+    if (present & LXW_SERIES_SPEC_TRENDLINE_FORECAST)
+        chart_series_set_trendline_forecast(series, spec->trendline_forward,
+                                            spec->trendline_backward);
+
+    if (present & LXW_SERIES_SPEC_TRENDLINE_EQUATION)
+        chart_series_set_trendline_equation(series);
+
+    if (present & LXW_SERIES_SPEC_TRENDLINE_R_SQUARED)
+        chart_series_set_trendline_r_squared(series);
+
+    if (present & LXW_SERIES_SPEC_TRENDLINE_INTERCEPT)
+        chart_series_set_trendline_intercept(series,
+                                             spec->trendline_intercept);
+
+    if (present & LXW_SERIES_SPEC_TRENDLINE_LINE) {
+        lxw_chart_line line = { 0 };
+
+        line.color = spec->trendline_line_color;
+        line.width = (float) spec->trendline_line_width;
+        line.dash_type = spec->trendline_line_dash_type;
+        chart_series_set_trendline_line(series, &line);
+    }
+
+    if ((present & LXW_SERIES_SPEC_TRENDLINE_NAME) && trendline_name)
+        chart_series_set_trendline_name(series, trendline_name);
+}
+
+/*
+ * Apply one series spec to an array of series handles. The strings are
+ * converted once for the whole array. Null handles are skipped.
+ */
+lxw_error
+chart_series_configure_many_lv(lxw_chart_series **series, uint32_t count,
+                               const lxw_series_spec *spec,
+                               const char *labels_num_format,
+                               const char *trendline_name)
+{
+    char *utf8_num_format;
+    char *utf8_name;
+    uint32_t i;
+
+    if (!series || !spec)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    utf8_num_format = ansi_to_utf8(labels_num_format);
+    utf8_name = ansi_to_utf8(trendline_name);
+
+    for (i = 0; i < count; i++) {
+        if (series[i])
+            series_configure(series[i], spec,
+                             utf8_num_format ? utf8_num_format
+                             : labels_num_format,
+                             utf8_name ? utf8_name : trendline_name);
+    }
+
+    free(utf8_num_format);
+    free(utf8_name);
+    return LXW_NO_ERROR;
+}
+
+/*
+ * Apply every setting of a series spec whose bit is set in spec->present.
+ * labels_num_format and trendline_name are passed separately as LabVIEW
+ * strings.
+ */
+void
+chart_series_configure_lv(lxw_chart_series *series,
+                          const lxw_series_spec *spec,
+                          const char *labels_num_format,
+                          const char *trendline_name)
+{
+    chart_series_configure_many_lv(&series, 1, spec, labels_num_format,
+                                   trendline_name);
+}
+
+/* ============================================================================
+ * Format functions
+ * ============================================================================ */
+
+void
+format_set_font_name_lv(lxw_format *format, const char *font_name)
+{
+    char *utf8 = ansi_to_utf8(font_name);
+    format_set_font_name(format, utf8 ? utf8 : font_name);
+    free(utf8);
+}
+
+void
+format_set_num_format_lv(lxw_format *format, const char *num_format)
+{
+    char *utf8 = ansi_to_utf8(num_format);
+    format_set_num_format(format, utf8 ? utf8 : num_format);
+    free(utf8);
+}
+
+/* ============================================================================
+ * Workbook functions
+ * ============================================================================ */
+
+lxw_worksheet *
+workbook_add_worksheet_lv(lxw_workbook *workbook, const char *sheetname)
+{
+    /* Pass NULL to get default Sheet1, Sheet2, etc. names */
+    if (!sheetname || !*sheetname) {
+        return workbook_add_worksheet(workbook, NULL);
+    }
+    char *utf8 = ansi_to_utf8(sheetname);
+    lxw_worksheet *ws =
+        workbook_add_worksheet(workbook, utf8 ? utf8 : sheetname);
+    free(utf8);
+    return ws;
+}
+
+lxw_chartsheet *
+workbook_add_chartsheet_lv(lxw_workbook *workbook, const char *sheetname)
+{
+    /* Pass NULL to get default Chart1, Chart2, etc. names */
+    if (!sheetname || !*sheetname) {
+        return workbook_add_chartsheet(workbook, NULL);
+    }
+    char *utf8 = ansi_to_utf8(sheetname);
+    lxw_chartsheet *cs =
+        workbook_add_chartsheet(workbook, utf8 ? utf8 : sheetname);
+    free(utf8);
+    return cs;
+}
+
+lxw_error
+workbook_define_name_lv(lxw_workbook *workbook, const char *name,
+                        const char *formula)
+{
+    char *utf8_name = ansi_to_utf8(name);
+    char *utf8_formula = ansi_to_utf8(formula);
+    lxw_error err = workbook_define_name(workbook,
+                                         utf8_name ? utf8_name : name,
+                                         utf8_formula ? utf8_formula :
+                                         formula);
+    free(utf8_name);
+    free(utf8_formula);
+    return err;
+}
+
+lxw_worksheet *
+workbook_get_worksheet_by_name_lv(lxw_workbook *workbook, const char *name)
+{
+    char *utf8 = ansi_to_utf8(name);
+    lxw_worksheet *ws =
+        workbook_get_worksheet_by_name(workbook, utf8 ? utf8 : name);
+    free(utf8);
+    return ws;
+}
+
+lxw_chartsheet *
+workbook_get_chartsheet_by_name_lv(lxw_workbook *workbook, const char *name)
+{
+    char *utf8 = ansi_to_utf8(name);
+    lxw_chartsheet *cs =
+        workbook_get_chartsheet_by_name(workbook, utf8 ? utf8 : name);
+    free(utf8);
+    return cs;
+}
+
+lxw_error
+workbook_validate_sheet_name_lv(lxw_workbook *workbook, const char *sheetname)
+{
+    char *utf8 = ansi_to_utf8(sheetname);
+    lxw_error err =
+        workbook_validate_sheet_name(workbook, utf8 ? utf8 : sheetname);
+    free(utf8);
+    return err;
+}
+
+lxw_error
+workbook_set_custom_property_string_lv(lxw_workbook *workbook,
+                                       const char *name, const char *value)
+{
+    char *utf8_name = ansi_to_utf8(name);
+    char *utf8_value = ansi_to_utf8(value);
     lxw_error err = workbook_set_custom_property_string(workbook,
                                                         utf8_name ? utf8_name
                                                         : name,
@@ -457,6 +1489,166 @@ chartsheet_set_footer_lv(lxw_chartsheet *chartsheet, const char *footer)
     return err;
 }
 
+/*
+ * Shared definition for charts created by workbook_add_chartsheets_lv().
+ * The nested specs start on 8 byte boundaries so the cluster has no
+ * padding.
+ */
+typedef struct lxw_chart_template {
+    lxw_series_spec series;
+    lxw_axis_spec x_axis;
+    lxw_axis_spec y_axis;
+    uint8_t chart_type;
+    uint8_t style;
+    uint8_t title_from_name;
+    uint8_t legend_none;
+    uint8_t paper_type;
+    uint8_t portrait;
+    uint8_t reserved[2];
+} lxw_chart_template;
+
+/* Data for one chartsheet: rows of a value column and an optional
+ * category column (-1 for none) of the data worksheet. */
+typedef struct lxw_chart_data_range {
+    lxw_row_t first_row;
+    lxw_row_t last_row;
+    int32_t categories_col;
+    lxw_col_t values_col;
+    uint16_t reserved;
+} lxw_chart_data_range;
+
+/*
+ * Create one chartsheet per name, each holding a chart with a single
+ * series plotting data_ranges[i] of data_worksheet. The name is used for
+ * the sheet and the series (and the chart title with title_from_name).
+ * Every chart is styled from the same template, with the axis names
+ * transcoded once. The chartsheet handles are stored in chartsheets_out
+ * if it isn't NULL (0 for any that failed). Returns the first error and
+ * carries on with the remaining names.
+ */
+lxw_error
+workbook_add_chartsheets_lv(lxw_workbook *workbook,
+                            lv_str_array_handle names,
+                            const lxw_chart_template *chart_template,
+                            lxw_worksheet *data_worksheet,
+                            const lxw_chart_data_range *data_ranges,
+                            const char *x_axis_name,
+                            const char *y_axis_name,
+                            uintptr_t *chartsheets_out)
+{
+    lv_arena arena = { 0 };
+    int32_t num_names = lv_str_array_size(names);
+    const char *utf8_x_name = NULL;
+    const char *utf8_y_name = NULL;
+    lxw_error first_err = LXW_NO_ERROR;
+    int32_t i;
+
+    if (!workbook || !chart_template || !data_worksheet || !data_ranges
+        || num_names == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (x_axis_name && *x_axis_name)
+        utf8_x_name = arena_utf8(&arena, x_axis_name,
+                                 (int32_t) strlen(x_axis_name));
+    if (y_axis_name && *y_axis_name)
+        utf8_y_name = arena_utf8(&arena, y_axis_name,
+                                 (int32_t) strlen(y_axis_name));
+
+    for (i = 0; i < num_names; i++) {
+        const lxw_chart_data_range *range = &data_ranges[i];
+        lxw_chartsheet *chartsheet = NULL;
+        lxw_chart_series *series;
+        lxw_chart *chart;
+        const char *name;
+        int32_t len;
+        lxw_error err;
+
+        if (chartsheets_out)
+            chartsheets_out[i] = 0;
+
+        name = lv_str_array_get(names, i, &len);
+        name = len ? arena_utf8(&arena, name, len) : NULL;
+        if (len && !name) {
+            first_err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            break;
+        }
+
+        if (name) {
+            err = workbook_validate_sheet_name(workbook, name);
+            if (err) {
+                if (!first_err)
+                    first_err = err;
+                continue;
+            }
+        }
+
+        chart = workbook_add_chart(workbook, chart_template->chart_type);
+        if (chart)
+            chartsheet = workbook_add_chartsheet(workbook, name);
+
+        if (!chart || !chartsheet) {
+            if (!first_err)
+                first_err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            continue;
+        }
+
+        series = chart_add_series_impl(chart, NULL, NULL, 0);
+        if (!series) {
+            if (!first_err)
+                first_err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            continue;
+        }
+
+        if (range->categories_col >= 0)
+            chart_series_set_categories(series, data_worksheet->name,
+                                        range->first_row,
+                                        (lxw_col_t) range->categories_col,
+                                        range->last_row,
+                                        (lxw_col_t) range->categories_col);
+
+        chart_series_set_values(series, data_worksheet->name,
+                                range->first_row, range->values_col,
+                                range->last_row, range->values_col);
+
+        if (name) {
+            chart_series_set_name(series, name);
+            if (chart_template->title_from_name)
+                chart_title_set_name(chart, name);
+        }
+
+        series_configure(series, &chart_template->series, NULL, NULL);
+        axis_configure(chart->x_axis, &chart_template->x_axis, utf8_x_name,
+                       NULL);
+        axis_configure(chart->y_axis, &chart_template->y_axis, utf8_y_name,
+                       NULL);
+
+        if (chart_template->style)
+            chart_set_style(chart, chart_template->style);
+
+        if (chart_template->legend_none)
+            chart_legend_set_position(chart, LXW_CHART_LEGEND_NONE);
+
+        if (chart_template->paper_type)
+            chartsheet_set_paper(chartsheet, chart_template->paper_type);
+
+        if (chart_template->portrait)
+            chartsheet_set_portrait(chartsheet);
+
+        err = chartsheet_set_chart(chartsheet, chart);
+        if (err) {
+            if (!first_err)
+                first_err = err;
+            continue;
+        }
+
+        if (chartsheets_out)
+            chartsheets_out[i] = (uintptr_t) chartsheet;
+    }
+
+    arena_free(&arena);
+    return first_err;
+}
+
 /* ============================================================================
  * File path functions (ANSI to UTF-8 conversion for lxw_fopen compatibility)
  * ============================================================================ */
@@ -625,11 +1817,54 @@ worksheet_filter_column2_lv(lxw_worksheet *worksheet, lxw_col_t col,
     return err;
 }
 
-/* ============================================================================
- * Chart data label functions
- * ============================================================================ */
-
-lxw_error
+/*
+ * Filter a column to a list of values. The values come as a LabVIEW string
+ * array; they are transcoded into one arena and the NULL terminated list
+ * that worksheet_filter_list() expects is built there too.
+ */
+lxw_error
+worksheet_filter_list_lv(lxw_worksheet *worksheet, lxw_col_t col,
+                         lv_str_array_handle values)
+{
+    lv_arena arena = { 0 };
+    const char **list;
+    int32_t num_values = lv_str_array_size(values);
+    int32_t i;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!worksheet || num_values == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    list = (const char **) arena_alloc(&arena, ((size_t) num_values + 1) *
+                                       sizeof(char *));
+    if (!list)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    for (i = 0; i < num_values; i++) {
+        int32_t len;
+        const char *value = lv_str_array_get(values, i, &len);
+
+        list[i] = arena_utf8(&arena, value, len);
+        if (!list[i]) {
+            err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            break;
+        }
+    }
+
+    if (!err) {
+        list[num_values] = NULL;
+        err = worksheet_filter_list(worksheet, col, list);
+    }
+
+    arena_free(&arena);
+    return err;
+}
+
+/* ============================================================================
+ * Chart data label functions
+ * ============================================================================ */
+
+lxw_error
 chart_series_set_labels_custom_lv(lxw_chart_series *series,
                                   uintptr_t *values,
                                   uint8_t *hide_flags, uint16_t count)
@@ -701,3 +1936,6385 @@ chart_series_set_labels_custom_lv(lxw_chart_series *series,
 
     return err;
 }
+
+/*
+ * Style for a group of data labels: a font and a fill. A font that is all
+ * zeros and a fill with no color and no "none" flag are left unset.
+ */
+typedef struct lxw_label_style {
+    double font_size;
+    int32_t font_rotation;
+    lxw_color_t font_color;
+    lxw_color_t fill_color;
+    uint8_t font_bold;
+    uint8_t font_italic;
+    uint8_t fill_none;
+    uint8_t fill_transparency;
+} lxw_label_style;
+
+/* libxlsxwriter counts data labels in a uint16_t. */
+#define LV_MAX_DATA_LABELS 65535
+
+/* Width of the formatted number part of a label, before any prefix or
+ * suffix. Enough for any double with grouping and 30 decimals. */
+#define LV_LABEL_NUMBER_SIZE 512
+
+typedef enum lv_label_format_type {
+    LV_LABEL_FORMAT_PRINTF = 0,
+    LV_LABEL_FORMAT_EXCEL
+} lv_label_format_type;
+
+/* A parsed label number format. */
+typedef struct lv_label_format {
+    lv_label_format_type type;
+
+    /* printf style: the format, validated to hold one floating point
+     * conversion. */
+    const char *printf_format;
+
+    /* Excel style: literal text around a "#,##0.00" style pattern. */
+    const char *prefix;
+    size_t prefix_len;
+    const char *suffix;
+    size_t suffix_len;
+    uint8_t min_decimals;
+    uint8_t max_decimals;
+    uint8_t grouping;
+    uint8_t percent;
+} lv_label_format;
+
+/* Return the end of a printf floating point conversion starting at the
+ * '%' at p, or NULL if there isn't one. */
+static const char *
+label_format_conversion(const char *p)
+{
+    int i;
+
+    p++;
+    p += strspn(p, "-+ #0");
+    for (i = 0; i < 2 && *p >= '0' && *p <= '9'; i++)
+        p++;
+    if (*p == '.') {
+        p++;
+        for (i = 0; i < 2 && *p >= '0' && *p <= '9'; i++)
+            p++;
+    }
+
+    return (*p && strchr("fFeEgG", *p)) ? p + 1 : NULL;
+}
+
+/* Copy the text from start to end without its quotes, returning the
+ * length copied. */
+static size_t
+label_format_unquote(char *dest, const char *start, const char *end)
+{
+    size_t len = 0;
+
+    for (; start < end; start++) {
+        if (*start != '"')
+            dest[len++] = *start;
+    }
+
+    return len;
+}
+
+/*
+ * Parse a number format. A format with a %f, %e or %g conversion (with
+ * flags, width and precision) is printf style and may hold only that one
+ * conversion plus %% escapes. Anything else is a simple Excel style
+ * format: literal text, a pattern of 0 # , . characters and literal text,
+ * with a trailing % scaling the value by 100. Literal text may be quoted,
+ * so that it can hold 0 or #; the quotes are dropped.
+ */
+static int
+label_format_parse(lv_label_format *format, lv_arena *arena, const char *str)
+{
+    const char *p;
+    const char *pattern;
+    int conversions = 0;
+    int others = 0;
+    int after_point = 0;
+    char *literal;
+    size_t len;
+
+    memset(format, 0, sizeof(lv_label_format));
+
+    if (!str || !*str)
+        str = "%g";
+
+    for (p = str; (p = strchr(p, '%')) != NULL;) {
+        const char *end;
+
+        if (p[1] == '%') {
+            p += 2;
+        }
+        else if ((end = label_format_conversion(p)) != NULL) {
+            conversions++;
+            p = end;
+        }
+        else {
+            others++;
+            p++;
+        }
+    }
+
+    if (conversions) {
+        if (conversions > 1 || others)
+            return 0;
+
+        format->type = LV_LABEL_FORMAT_PRINTF;
+        format->printf_format = str;
+        return 1;
+    }
+
+    /* Excel style. Find the pattern outside quoted text, so a 0 or # in a
+     * quoted literal stays literal. */
+    for (p = str; *p && !strchr("0#", *p); p++) {
+        if (*p == '"') {
+            p = strchr(p + 1, '"');
+            if (!p)
+                return 0;
+        }
+    }
+
+    if (!*p)
+        return 0;
+
+    pattern = p;
+    for (; *p && strchr("0#,.", *p); p++) {
+        if (*p == '.')
+            after_point = 1;
+        else if (*p == ',' && !after_point)
+            format->grouping = 1;
+        else if (after_point && format->max_decimals < 30 && *p != ',') {
+            format->max_decimals++;
+            if (*p == '0')
+                format->min_decimals = format->max_decimals;
+        }
+    }
+
+    /* Copy the literals with quotes removed so they are plain. */
+    len = strlen(str);
+    literal = (char *) arena_alloc(arena, len + 1);
+    if (!literal)
+        return 0;
+
+    format->type = LV_LABEL_FORMAT_EXCEL;
+    format->percent = (*p == '%');
+    format->prefix = literal;
+    format->prefix_len = label_format_unquote(literal, str, pattern);
+    format->suffix = literal + format->prefix_len;
+    format->suffix_len = label_format_unquote(literal + format->prefix_len,
+                                              p, str + len);
+    literal[format->prefix_len + format->suffix_len] = '\0';
+    return 1;
+}
+
+/* Format a number with an Excel style pattern into buf, returning the
+ * length. */
+static size_t
+label_format_excel(const lv_label_format *format, double value, char *buf)
+{
+    char digits[LV_LABEL_NUMBER_SIZE];
+    int len;
+    int int_len;
+    size_t out = 0;
+    int i;
+
+    if (format->percent)
+        value *= 100.0;
+
+    /* Round halves away from zero like Excel, not to even like printf. */
+    if (fabs(value) < 1e15) {
+        double scale = pow(10.0, format->max_decimals);
+        value = round(value * scale) / scale;
+    }
+
+    len = snprintf(digits, sizeof(digits), "%.*f",
+                   (int) format->max_decimals, fabs(value));
+    if (len <= 0 || len >= (int) sizeof(digits))
+        return 0;
+
+    /* Drop optional (#) decimals that are zero. */
+    if (format->max_decimals) {
+        int min_len = len - format->max_decimals + format->min_decimals;
+
+        while (len > min_len && digits[len - 1] == '0')
+            len--;
+        if (digits[len - 1] == '.')
+            len--;
+    }
+
+    int_len = (int) strcspn(digits, ".");
+    if (int_len > len)
+        int_len = len;
+
+    if (value < 0.0 && strspn(digits, "0.") < (size_t) len)
+        buf[out++] = '-';
+
+    for (i = 0; i < int_len; i++) {
+        if (format->grouping && i > 0 && (int_len - i) % 3 == 0)
+            buf[out++] = ',';
+        buf[out++] = digits[i];
+    }
+
+    memcpy(buf + out, digits + int_len, len - int_len);
+    return out + len - int_len;
+}
+
+/* Format a label value into the arena. */
+static char *
+label_format_value(const lv_label_format *format, lv_arena *arena,
+                   double value)
+{
+    char number[LV_LABEL_NUMBER_SIZE];
+    size_t number_len;
+    char *label;
+
+    if (format->type == LV_LABEL_FORMAT_PRINTF) {
+        int len = snprintf(number, sizeof(number), format->printf_format,
+                           value);
+        if (len < 0)
+            return NULL;
+
+        number_len = (size_t) len < sizeof(number) ? (size_t) len
+            : sizeof(number) - 1;
+        return arena_strndup(arena, number, number_len);
+    }
+
+    number_len = label_format_excel(format, value, number);
+
+    label = (char *) arena_alloc(arena, format->prefix_len + number_len +
+                                 format->suffix_len + 1);
+    if (!label)
+        return NULL;
+
+    /* The sign goes before any prefix, as in "-$1,000". */
+    if (number_len && number[0] == '-') {
+        *label++ = '-';
+        memcpy(label, format->prefix, format->prefix_len);
+        memcpy(label + format->prefix_len, number + 1, number_len - 1);
+        memcpy(label + format->prefix_len + number_len - 1, format->suffix,
+               format->suffix_len + 1);
+        return label - 1;
+    }
+
+    memcpy(label, format->prefix, format->prefix_len);
+    memcpy(label + format->prefix_len, number, number_len);
+    memcpy(label + format->prefix_len + number_len, format->suffix,
+           format->suffix_len + 1);
+    return label;
+}
+
+/*
+ * Extended custom data labels. Each label's text comes from, in order:
+ * a non-empty element of the LabVIEW string array strings, a non-NaN
+ * element of values formatted with value_format, or the default label.
+ * value_format is printf style ("%.2f V") or simple Excel style
+ * ("#,##0.00", "0.0%"); empty gives "%g". style_indices select an entry of
+ * styles for each label's font and fill (out of range for none). Any of
+ * the arrays may be NULL or empty. Everything, including the label text,
+ * is built in one arena.
+ */
+lxw_error
+chart_series_set_labels_custom2_lv(lxw_chart_series *series, uint32_t count,
+                                   lv_str_array_handle strings,
+                                   const double *values,
+                                   const char *value_format,
+                                   const uint8_t *hide_flags,
+                                   const uint8_t *style_indices,
+                                   const lxw_label_style *styles,
+                                   uint32_t num_styles)
+{
+    lv_arena arena = { 0 };
+    lv_label_format format;
+    lxw_chart_data_label *labels;
+    lxw_chart_data_label **label_ptrs;
+    lxw_chart_font **fonts = NULL;
+    lxw_chart_fill **fills = NULL;
+    int32_t num_strings = lv_str_array_size(strings);
+    uint32_t i;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!series || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (count > LV_MAX_DATA_LABELS)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if (!styles)
+        num_styles = 0;
+
+    labels = (lxw_chart_data_label *)
+        arena_alloc(&arena, count * sizeof(lxw_chart_data_label));
+    label_ptrs = (lxw_chart_data_label **)
+        arena_alloc(&arena, (count + 1) * sizeof(lxw_chart_data_label *));
+
+    if (!labels || !label_ptrs) {
+        arena_free(&arena);
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    memset(labels, 0, count * sizeof(lxw_chart_data_label));
+
+    if (values) {
+        const char *utf8_format = NULL;
+
+        if (value_format && *value_format) {
+            utf8_format = arena_utf8(&arena, value_format,
+                                     (int32_t) strlen(value_format));
+            if (!utf8_format) {
+                arena_free(&arena);
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+            }
+        }
+
+        if (!label_format_parse(&format, &arena, utf8_format)) {
+            arena_free(&arena);
+            return LXW_ERROR_PARAMETER_VALIDATION;
+        }
+    }
+
+    /* One font and fill per style, shared by all labels using it. */
+    if (num_styles) {
+        fonts = (lxw_chart_font **)
+            arena_alloc(&arena, num_styles * sizeof(lxw_chart_font *));
+        fills = (lxw_chart_fill **)
+            arena_alloc(&arena, num_styles * sizeof(lxw_chart_fill *));
+        if (!fonts || !fills) {
+            arena_free(&arena);
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+
+        for (i = 0; i < num_styles; i++) {
+            const lxw_label_style *style = &styles[i];
+
+            fonts[i] = NULL;
+            fills[i] = NULL;
+
+            if (style->font_size > 0 || style->font_rotation
+                || style->font_color || style->font_bold
+                || style->font_italic) {
+                fonts[i] = (lxw_chart_font *)
+                    arena_alloc(&arena, sizeof(lxw_chart_font));
+                if (!fonts[i]) {
+                    err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                    break;
+                }
+
+                memset(fonts[i], 0, sizeof(lxw_chart_font));
+                fonts[i]->size = style->font_size;
+                fonts[i]->rotation = style->font_rotation;
+                fonts[i]->color = style->font_color;
+                fonts[i]->bold = style->font_bold;
+                fonts[i]->italic = style->font_italic;
+            }
+
+            if (style->fill_color || style->fill_none) {
+                fills[i] = (lxw_chart_fill *)
+                    arena_alloc(&arena, sizeof(lxw_chart_fill));
+                if (!fills[i]) {
+                    err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                    break;
+                }
+
+                memset(fills[i], 0, sizeof(lxw_chart_fill));
+                fills[i]->color = style->fill_color;
+                fills[i]->none = style->fill_none;
+                fills[i]->transparency = style->fill_transparency;
+            }
+        }
+    }
+
+    for (i = 0; i < count && !err; i++) {
+        lxw_chart_data_label *label = &labels[i];
+        int32_t len = 0;
+
+        label_ptrs[i] = label;
+
+        if ((int32_t) i < num_strings) {
+            const char *str = lv_str_array_get(strings, (int32_t) i, &len);
+
+            if (len) {
+                label->value = arena_utf8(&arena, str, len);
+                if (!label->value)
+                    err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            }
+        }
+
+        if (!len && values && !isnan(values[i])) {
+            label->value = label_format_value(&format, &arena, values[i]);
+            if (!label->value)
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+
+        if (hide_flags)
+            label->hide = hide_flags[i];
+
+        if (style_indices && style_indices[i] < num_styles) {
+            label->font = fonts[style_indices[i]];
+            label->fill = fills[style_indices[i]];
+        }
+    }
+
+    if (!err) {
+        label_ptrs[count] = NULL;
+        err = chart_series_set_labels_custom(series, label_ptrs);
+    }
+
+    arena_free(&arena);
+    return err;
+}
+
+/* ============================================================================
+ * Chart point functions
+ * ============================================================================ */
+
+/* libxlsxwriter counts series points in a uint16_t. */
+#define LV_MAX_CHART_POINTS 65535
+
+/* Open addressing map from a point color to its shared fill. */
+typedef struct lv_fill_slot {
+    lxw_color_t color;
+    lxw_chart_fill *fill;
+} lv_fill_slot;
+
+/*
+ * Map a LabVIEW color to a point color. Black is 0 in LabVIEW but 0 means
+ * "not set" in libxlsxwriter. LabVIEW's transparent and system colors have
+ * the high byte set and leave the point at its default, returned as 0.
+ */
+static lxw_color_t
+lv_point_color(uint32_t color)
+{
+    if (color > 0xFFFFFF)
+        return 0;
+
+    return color ? color : LXW_COLOR_BLACK;
+}
+
+/*
+ * Color the points of a series from an array. With palette_mode 0, colors
+ * holds LabVIEW RGB colors. With palette_mode 1, it holds indices into
+ * palette (e.g. 0 = pass, 1 = fail) and out of range indices leave the
+ * point at its default. Points with the same color share one fill, and
+ * trailing default points are dropped, so a series with thousands of
+ * points is built from a few allocations in one arena.
+ */
+lxw_error
+chart_series_set_point_colors_lv(lxw_chart_series *series,
+                                 const uint32_t *colors, uint32_t count,
+                                 const uint32_t *palette,
+                                 uint32_t palette_size, uint8_t palette_mode)
+{
+    lv_arena arena = { 0 };
+    lxw_chart_point **point_ptrs;
+    lxw_chart_point *points;
+    lxw_chart_fill **palette_fills = NULL;
+    lv_fill_slot *slots = NULL;
+    uint32_t num_slots = 0;
+    uint32_t num_points = 0;
+    uint32_t i;
+    lxw_error err;
+
+    if (!series || !colors || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (palette_mode && (!palette || palette_size == 0))
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (count > LV_MAX_CHART_POINTS)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    /* Trailing default points don't need to be written. */
+    for (i = count; i > 0; i--) {
+        uint32_t color = colors[i - 1];
+
+        if (palette_mode ? (color < palette_size
+                            && lv_point_color(palette[color]))
+            : lv_point_color(color) != 0) {
+            num_points = i;
+            break;
+        }
+    }
+
+    if (num_points == 0)
+        return LXW_NO_ERROR;
+
+    point_ptrs = (lxw_chart_point **)
+        arena_alloc(&arena, (num_points + 1) * sizeof(lxw_chart_point *));
+    points = (lxw_chart_point *)
+        arena_alloc(&arena, num_points * sizeof(lxw_chart_point));
+
+    if (palette_mode) {
+        palette_fills = (lxw_chart_fill **)
+            arena_alloc(&arena, palette_size * sizeof(lxw_chart_fill *));
+        if (palette_fills)
+            memset(palette_fills, 0, palette_size * sizeof(lxw_chart_fill *));
+    }
+    else {
+        for (num_slots = 16; num_slots < num_points * 2; num_slots *= 2);
+
+        slots = (lv_fill_slot *) arena_alloc(&arena,
+                                             num_slots * sizeof(lv_fill_slot));
+        if (slots)
+            memset(slots, 0, num_slots * sizeof(lv_fill_slot));
+    }
+
+    if (!point_ptrs || !points || (!palette_fills && !slots)) {
+        arena_free(&arena);
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    memset(points, 0, num_points * sizeof(lxw_chart_point));
+
+    for (i = 0; i < num_points; i++) {
+        lxw_chart_fill **fill_ref = NULL;
+        lxw_color_t color;
+
+        point_ptrs[i] = &points[i];
+
+        if (palette_mode) {
+            if (colors[i] >= palette_size)
+                continue;
+
+            color = lv_point_color(palette[colors[i]]);
+            fill_ref = &palette_fills[colors[i]];
+        }
+        else {
+            uint32_t slot;
+
+            color = lv_point_color(colors[i]);
+            if (!color)
+                continue;
+
+            slot = (color * 2654435761u) & (num_slots - 1);
+            while (slots[slot].color && slots[slot].color != color)
+                slot = (slot + 1) & (num_slots - 1);
+
+            slots[slot].color = color;
+            fill_ref = &slots[slot].fill;
+        }
+
+        if (!color)
+            continue;
+
+        if (!*fill_ref) {
+            *fill_ref = (lxw_chart_fill *) arena_alloc(&arena,
+                                                       sizeof(lxw_chart_fill));
+            if (!*fill_ref) {
+                arena_free(&arena);
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+            }
+
+            memset(*fill_ref, 0, sizeof(lxw_chart_fill));
+            (*fill_ref)->color = color;
+        }
+
+        points[i].fill = *fill_ref;
+    }
+
+    point_ptrs[num_points] = NULL;
+
+    /* libxlsxwriter copies the points, so the arena can go straight away. */
+    err = chart_series_set_points(series, point_ptrs);
+
+    arena_free(&arena);
+    return err;
+}
+
+/* ============================================================================
+ * Staging table functions
+ *
+ * A staging table holds column data natively so that large datasets can be
+ * reordered and written to a worksheet without round trips through G.
+ * Number columns are stored as doubles and string columns are dictionary
+ * encoded: each cell holds an id into a per-column table of distinct UTF-8
+ * strings. Rows are emitted in the table's current order, which sorting
+ * changes without moving any column data.
+ * ============================================================================ */
+
+typedef enum lxw_staging_column_type {
+    LXW_STAGING_COLUMN_NUMBER = 0,
+    LXW_STAGING_COLUMN_STRING = 1
+} lxw_staging_column_type;
+
+/* String cell id for a blank cell. */
+#define LXW_STAGING_BLANK LV_DICT_NOT_FOUND
+
+typedef struct lxw_staging_column {
+    char *name;
+    uint8_t type;
+    uint32_t num_rows;
+    uint32_t capacity;
+    double *numbers;
+    uint32_t *ids;
+    lv_dict dict;
+} lxw_staging_column;
+
+typedef struct lxw_staging_table {
+    lxw_staging_column *columns;
+    uint16_t num_cols;
+
+    /* Length of the longest column. Cells past the end of a shorter column
+     * are blank. */
+    uint32_t num_rows;
+
+    /* Row emit order, or NULL for insertion order. */
+    uint32_t *order;
+
+    /* Bitmap of selected rows, or NULL when every row is selected. */
+    uint64_t *selection;
+
+    /* Where the last emit wrote the table: the table row written to each
+     * worksheet row from emit_first_row on, and which of those rows have
+     * been hidden by an autofilter. */
+    lxw_worksheet *emit_worksheet;
+    lxw_row_t emit_first_row;
+    lxw_col_t emit_first_col;
+    uint32_t *emit_rows;
+    uint32_t emit_count;
+    uint64_t *emit_hidden;
+
+    lv_arena arena;
+} lxw_staging_table;
+
+static int
+staging_column_is_blank(const lxw_staging_column *column, uint32_t row)
+{
+    if (row >= column->num_rows)
+        return 1;
+
+    if (column->type == LXW_STAGING_COLUMN_STRING)
+        return column->ids[row] == LXW_STAGING_BLANK;
+
+    /* NaN and infinities can't be stored in a cell. */
+    return !isfinite(column->numbers[row]);
+}
+
+static const char *
+staging_cell_string(const lxw_staging_column *column, uint32_t row)
+{
+    return column->dict.strings[column->ids[row]];
+}
+
+static int
+staging_row_selected(const lxw_staging_table *table, uint32_t row)
+{
+    if (!table->selection)
+        return 1;
+
+    return (table->selection[row / 64] >> (row % 64)) & 1;
+}
+
+static lxw_error
+staging_write_cell(lxw_worksheet *worksheet, lxw_row_t row, lxw_col_t col,
+                   const lxw_staging_column *column, uint32_t table_row,
+                   lxw_format *format)
+{
+    if (staging_column_is_blank(column, table_row))
+        return LXW_NO_ERROR;
+
+    if (column->type == LXW_STAGING_COLUMN_STRING)
+        return worksheet_write_string(worksheet, row, col,
+                                      staging_cell_string(column, table_row),
+                                      format);
+    else
+        return worksheet_write_number(worksheet, row, col,
+                                      column->numbers[table_row], format);
+}
+
+static lxw_error
+staging_column_reserve(lxw_staging_column *column, uint32_t count)
+{
+    uint32_t capacity = column->capacity ? column->capacity : 1024;
+
+    if (count > UINT32_MAX - column->num_rows)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if (column->num_rows + count <= column->capacity)
+        return LXW_NO_ERROR;
+
+    while (capacity < column->num_rows + count)
+        capacity = capacity > UINT32_MAX / 2 ? UINT32_MAX : capacity * 2;
+
+    if (column->type == LXW_STAGING_COLUMN_STRING) {
+        uint32_t *ids =
+            (uint32_t *) realloc(column->ids, capacity * sizeof(uint32_t));
+        if (!ids)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        column->ids = ids;
+    }
+    else {
+        double *numbers =
+            (double *) realloc(column->numbers, capacity * sizeof(double));
+        if (!numbers)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        column->numbers = numbers;
+    }
+
+    column->capacity = capacity;
+    return LXW_NO_ERROR;
+}
+
+static void
+staging_table_rows_appended(lxw_staging_table *table,
+                            const lxw_staging_column *column)
+{
+    if (column->num_rows > table->num_rows)
+        table->num_rows = column->num_rows;
+
+    /* New rows invalidate a previous sort and selection. */
+    free(table->order);
+    table->order = NULL;
+    free(table->selection);
+    table->selection = NULL;
+}
+
+lxw_staging_table *
+staging_table_new_lv(const uint8_t *col_types, uint16_t num_cols)
+{
+    lxw_staging_table *table;
+    uint16_t i;
+
+    if (!col_types || num_cols == 0)
+        return NULL;
+
+    table = (lxw_staging_table *) calloc(1, sizeof(lxw_staging_table));
+    if (!table)
+        return NULL;
+
+    table->columns =
+        (lxw_staging_column *) calloc(num_cols, sizeof(lxw_staging_column));
+    if (!table->columns) {
+        free(table);
+        return NULL;
+    }
+
+    table->num_cols = num_cols;
+
+    for (i = 0; i < num_cols; i++) {
+        table->columns[i].type = col_types[i] == LXW_STAGING_COLUMN_STRING ?
+            LXW_STAGING_COLUMN_STRING : LXW_STAGING_COLUMN_NUMBER;
+    }
+
+    return table;
+}
+
+void
+staging_table_free_lv(lxw_staging_table *table)
+{
+    uint16_t i;
+
+    if (!table)
+        return;
+
+    for (i = 0; i < table->num_cols; i++) {
+        free(table->columns[i].numbers);
+        free(table->columns[i].ids);
+        dict_free(&table->columns[i].dict);
+    }
+
+    free(table->columns);
+    free(table->order);
+    free(table->selection);
+    free(table->emit_rows);
+    free(table->emit_hidden);
+    arena_free(&table->arena);
+    free(table);
+}
+
+uint32_t
+staging_table_num_rows_lv(lxw_staging_table *table)
+{
+    return table ? table->num_rows : 0;
+}
+
+lxw_error
+staging_table_set_column_names_lv(lxw_staging_table *table,
+                                  lv_str_array_handle names)
+{
+    int32_t count = lv_str_array_size(names);
+    int32_t i;
+
+    if (!table || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (count > table->num_cols)
+        count = table->num_cols;
+
+    for (i = 0; i < count; i++) {
+        int32_t len;
+        const char *str = lv_str_array_get(names, i, &len);
+
+        table->columns[i].name = arena_utf8(&table->arena, str, len);
+        if (!table->columns[i].name)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    return LXW_NO_ERROR;
+}
+
+lxw_error
+staging_table_append_numbers_lv(lxw_staging_table *table, lxw_col_t col,
+                                const double *values, uint32_t count)
+{
+    lxw_staging_column *column;
+    lxw_error err;
+
+    if (!table || !values || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (col >= table->num_cols
+        || table->columns[col].type != LXW_STAGING_COLUMN_NUMBER)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    column = &table->columns[col];
+
+    err = staging_column_reserve(column, count);
+    if (err)
+        return err;
+
+    memcpy(column->numbers + column->num_rows, values,
+           count * sizeof(double));
+    column->num_rows += count;
+
+    staging_table_rows_appended(table, column);
+    return LXW_NO_ERROR;
+}
+
+lxw_error
+staging_table_append_strings_lv(lxw_staging_table *table, lxw_col_t col,
+                                lv_str_array_handle strings)
+{
+    lxw_staging_column *column;
+    int32_t count = lv_str_array_size(strings);
+    int32_t i;
+    lxw_error err;
+
+    if (!table || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (col >= table->num_cols
+        || table->columns[col].type != LXW_STAGING_COLUMN_STRING)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    column = &table->columns[col];
+
+    err = staging_column_reserve(column, (uint32_t) count);
+    if (err)
+        return err;
+
+    for (i = 0; i < count; i++) {
+        int32_t len;
+        size_t utf8_len;
+        const char *str = lv_str_array_get(strings, i, &len);
+        const char *utf8;
+        uint32_t id = LXW_STAGING_BLANK;
+
+        if (len > 0) {
+            utf8 = arena_scratch_utf8(&table->arena, str, len, &utf8_len);
+            if (utf8)
+                id = dict_intern(&column->dict, &table->arena, utf8,
+                                 utf8_len);
+            if (id == LV_DICT_NOT_FOUND) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                break;
+            }
+        }
+
+        column->ids[column->num_rows++] = id;
+    }
+
+    staging_table_rows_appended(table, column);
+    return err;
+}
+
+/*
+ * Sorting. Each key is reduced to an unsigned integer that orders the same
+ * way as the cell values: doubles are bit-flipped into ordered integers and
+ * strings are replaced by the rank of their dictionary entry. The row
+ * permutation is then LSD radix sorted one key at a time, last key first,
+ * relying on each pass being stable. Keys are gathered once per key into a
+ * contiguous array so the radix passes only stream through memory.
+ */
+typedef struct lv_sort_item {
+    uint64_t key;
+    uint32_t row;
+} lv_sort_item;
+
+typedef struct lv_rank_entry {
+    const char *string;
+    uint32_t id;
+} lv_rank_entry;
+
+static int
+compare_rank_entries(const void *a, const void *b)
+{
+    return strcmp(((const lv_rank_entry *) a)->string,
+                  ((const lv_rank_entry *) b)->string);
+}
+
+/* Return an array mapping each dictionary id to its sorted rank. */
+static uint32_t *
+dict_ranks(const lv_dict *dict)
+{
+    lv_rank_entry *entries;
+    uint32_t *ranks;
+    uint32_t i;
+
+    ranks = (uint32_t *) malloc((dict->count + 1) * sizeof(uint32_t));
+    entries = (lv_rank_entry *) malloc((dict->count + 1) *
+                                       sizeof(lv_rank_entry));
+    if (!ranks || !entries) {
+        free(ranks);
+        free(entries);
+        return NULL;
+    }
+
+    for (i = 0; i < dict->count; i++) {
+        entries[i].string = dict->strings[i];
+        entries[i].id = i;
+    }
+
+    qsort(entries, dict->count, sizeof(lv_rank_entry), compare_rank_entries);
+
+    for (i = 0; i < dict->count; i++)
+        ranks[entries[i].id] = i;
+
+    free(entries);
+    return ranks;
+}
+
+static uint64_t
+double_sort_key(double value)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (bits & 0x8000000000000000ull)
+        return ~bits;
+    else
+        return bits | 0x8000000000000000ull;
+}
+
+/*
+ * Stable LSD radix sort of items on the low num_bytes bytes of their key.
+ * Histograms for all bytes are built in one pass and bytes that are the
+ * same for every item are skipped. Returns whichever buffer holds the
+ * result.
+ */
+static lv_sort_item *
+radix_sort_items(lv_sort_item *items, lv_sort_item *tmp, uint32_t count,
+                 int num_bytes)
+{
+    uint32_t (*counts)[256];
+    uint32_t i;
+    int b;
+
+    counts = (uint32_t (*)[256]) calloc(8, sizeof(*counts));
+    if (!counts)
+        return NULL;
+
+    for (i = 0; i < count; i++) {
+        uint64_t key = items[i].key;
+
+        for (b = 0; b < num_bytes; b++)
+            counts[b][(key >> (b * 8)) & 0xFF]++;
+    }
+
+    for (b = 0; b < num_bytes; b++) {
+        uint32_t offsets[256];
+        uint32_t total = 0;
+        int shift = b * 8;
+        int bucket;
+        lv_sort_item *swap;
+
+        if (counts[b][(items[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        for (bucket = 0; bucket < 256; bucket++) {
+            offsets[bucket] = total;
+            total += counts[b][bucket];
+        }
+
+        for (i = 0; i < count; i++)
+            tmp[offsets[(items[i].key >> shift) & 0xFF]++] = items[i];
+
+        swap = items;
+        items = tmp;
+        tmp = swap;
+    }
+
+    free(counts);
+    return items;
+}
+
+lxw_error
+staging_table_sort_lv(lxw_staging_table *table, const uint16_t *key_cols,
+                      const uint8_t *descending, uint16_t num_keys)
+{
+    lv_sort_item *items = NULL;
+    lv_sort_item *tmp = NULL;
+    uint32_t *order = NULL;
+    uint32_t *ranks = NULL;
+    uint32_t count;
+    uint32_t i;
+    uint16_t k;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!table || !key_cols || num_keys == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    for (k = 0; k < num_keys; k++) {
+        if (key_cols[k] >= table->num_cols)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    count = table->num_rows;
+    if (count < 2)
+        return LXW_NO_ERROR;
+
+    items = (lv_sort_item *) malloc(count * sizeof(lv_sort_item));
+    tmp = (lv_sort_item *) malloc(count * sizeof(lv_sort_item));
+    order = (uint32_t *) malloc(count * sizeof(uint32_t));
+    if (!items || !tmp || !order) {
+        err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        goto mem_error;
+    }
+
+    for (i = 0; i < count; i++)
+        order[i] = i;
+
+    for (k = num_keys; k-- > 0;) {
+        const lxw_staging_column *column = &table->columns[key_cols[k]];
+        uint8_t desc = descending ? descending[k] : 0;
+        lv_sort_item *sorted;
+        int num_bytes;
+
+        if (column->type == LXW_STAGING_COLUMN_STRING) {
+            uint32_t blank_rank = column->dict.count;
+
+            ranks = dict_ranks(&column->dict);
+            if (!ranks) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                goto mem_error;
+            }
+
+            for (i = 0; i < count; i++) {
+                uint32_t row = order[i];
+                uint64_t key = blank_rank;
+
+                if (!staging_column_is_blank(column, row)) {
+                    key = ranks[column->ids[row]];
+                    if (desc)
+                        key = blank_rank - 1 - key;
+                }
+
+                items[i].key = key;
+                items[i].row = row;
+            }
+
+            free(ranks);
+            ranks = NULL;
+            num_bytes = 4;
+        }
+        else {
+            for (i = 0; i < count; i++) {
+                uint32_t row = order[i];
+                uint64_t key = UINT64_MAX;
+
+                /* Blanks sort last in either direction. */
+                if (!staging_column_is_blank(column, row)) {
+                    key = double_sort_key(column->numbers[row]);
+                    if (desc)
+                        key = ~key;
+                }
+
+                items[i].key = key;
+                items[i].row = row;
+            }
+
+            num_bytes = 8;
+        }
+
+        sorted = radix_sort_items(items, tmp, count, num_bytes);
+        if (!sorted) {
+            err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            goto mem_error;
+        }
+
+        for (i = 0; i < count; i++)
+            order[i] = sorted[i].row;
+    }
+
+    free(table->order);
+    table->order = order;
+    order = NULL;
+
+mem_error:
+    free(items);
+    free(tmp);
+    free(order);
+    return err;
+}
+
+lxw_error
+staging_table_emit_lv(lxw_staging_table *table, lxw_worksheet *worksheet,
+                      lxw_row_t first_row, lxw_col_t first_col,
+                      uintptr_t *col_formats)
+{
+    uint32_t i;
+    lxw_row_t out_row = first_row;
+    uint32_t *emit_rows;
+    uint16_t c;
+    lxw_error err;
+
+    if (!table || !worksheet)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    /* Remember the layout for autofilter and page break functions. */
+    emit_rows = (uint32_t *) malloc((table->num_rows + 1) *
+                                    sizeof(uint32_t));
+    if (!emit_rows)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    free(table->emit_rows);
+    free(table->emit_hidden);
+    table->emit_rows = emit_rows;
+    table->emit_hidden = NULL;
+    table->emit_count = 0;
+    table->emit_worksheet = worksheet;
+    table->emit_first_row = first_row;
+    table->emit_first_col = first_col;
+
+    /* Rows are written in order so this also works in constant_memory
+     * mode. Unselected rows are skipped without leaving gaps. */
+    for (i = 0; i < table->num_rows; i++) {
+        uint32_t row = table->order ? table->order[i] : i;
+
+        if (!staging_row_selected(table, row))
+            continue;
+
+        for (c = 0; c < table->num_cols; c++) {
+            lxw_format *format =
+                col_formats ? (lxw_format *) col_formats[c] : NULL;
+
+            err = staging_write_cell(worksheet, out_row, first_col + c,
+                                     &table->columns[c], row, format);
+            if (err)
+                return err;
+        }
+
+        table->emit_rows[table->emit_count++] = row;
+        out_row++;
+    }
+
+    return LXW_NO_ERROR;
+}
+
+/*
+ * Group-by aggregation. Rows are hashed on their key columns into an open
+ * addressing table of groups; string keys hash on their dictionary ids so
+ * no string data is touched. Groups are numbered in order of first
+ * appearance in the table's current order, so sorting first gives a sorted
+ * summary.
+ */
+typedef enum lxw_staging_aggregate {
+    LXW_STAGING_AGGREGATE_SUM = 0,
+    LXW_STAGING_AGGREGATE_COUNT = 1,
+    LXW_STAGING_AGGREGATE_MIN = 2,
+    LXW_STAGING_AGGREGATE_MAX = 3,
+    LXW_STAGING_AGGREGATE_MEAN = 4
+} lxw_staging_aggregate;
+
+/* Group id of rows excluded by the selection. */
+#define LV_NO_GROUP 0xFFFFFFFFu
+
+typedef struct lv_group_acc {
+    double sum;
+    double min;
+    double max;
+    uint32_t count;
+} lv_group_acc;
+
+static const char *const staging_aggregate_names[] = {
+    "Sum of ", "Count of ", "Min of ", "Max of ", "Mean of "
+};
+
+/* Key value of a cell for hashing and comparison. Blank is distinct from
+ * every value and -0.0 groups with 0.0. */
+static uint64_t
+staging_cell_key(const lxw_staging_column *column, uint32_t row)
+{
+    uint64_t bits;
+    double value;
+
+    if (staging_column_is_blank(column, row))
+        return UINT64_MAX;
+
+    if (column->type == LXW_STAGING_COLUMN_STRING)
+        return column->ids[row];
+
+    value = column->numbers[row] == 0.0 ? 0.0 : column->numbers[row];
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint32_t
+staging_row_hash(const lxw_staging_table *table, const uint16_t *key_cols,
+                 uint16_t num_keys, uint32_t row)
+{
+    uint64_t hash = 14695981039346656037ull;
+    uint16_t k;
+
+    for (k = 0; k < num_keys; k++) {
+        hash ^= staging_cell_key(&table->columns[key_cols[k]], row);
+        hash *= 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+static int
+staging_rows_equal(const lxw_staging_table *table, const uint16_t *key_cols,
+                   uint16_t num_keys, uint32_t row1, uint32_t row2)
+{
+    uint16_t k;
+
+    for (k = 0; k < num_keys; k++) {
+        const lxw_staging_column *column = &table->columns[key_cols[k]];
+
+        if (staging_cell_key(column, row1) != staging_cell_key(column, row2))
+            return 0;
+    }
+
+    return 1;
+}
+
+static lxw_error
+staging_write_header(lxw_staging_table *table, lxw_worksheet *worksheet,
+                     lxw_row_t row, lxw_col_t col, const char *prefix,
+                     uint16_t table_col, lxw_format *format)
+{
+    const char *name = table->columns[table_col].name;
+    char buffer[256];
+
+    if (name && *name)
+        snprintf(buffer, sizeof(buffer), "%s%s", prefix, name);
+    else
+        snprintf(buffer, sizeof(buffer), "%sColumn %u", prefix,
+                 (unsigned) table_col + 1);
+
+    return worksheet_write_string(worksheet, row, col, buffer, format);
+}
+
+lxw_error
+staging_table_group_by_lv(lxw_staging_table *table,
+                          const uint16_t *key_cols, uint16_t num_keys,
+                          const uint16_t *agg_cols, const uint8_t *agg_types,
+                          uint16_t num_aggs, lxw_worksheet *worksheet,
+                          lxw_row_t first_row, lxw_col_t first_col,
+                          lxw_format *header_format,
+                          lxw_format *number_format, lxw_chart *chart,
+                          uint32_t *num_groups_out)
+{
+    uint32_t *row_groups = NULL;
+    uint32_t *group_rows = NULL;
+    uint32_t *group_hashes = NULL;
+    uint32_t *slots = NULL;
+    lv_group_acc *accs = NULL;
+    uint32_t num_groups = 0;
+    uint32_t num_slots = 64;
+    uint32_t mask;
+    uint32_t i, g;
+    uint16_t k, a;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (num_groups_out)
+        *num_groups_out = 0;
+
+    if (!table || !worksheet || !key_cols || num_keys == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (num_aggs && (!agg_cols || !agg_types))
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    for (k = 0; k < num_keys; k++) {
+        if (key_cols[k] >= table->num_cols)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    for (a = 0; a < num_aggs; a++) {
+        if (agg_cols[a] >= table->num_cols
+            || agg_types[a] > LXW_STAGING_AGGREGATE_MEAN)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+
+        /* Only counts make sense for string columns. */
+        if (agg_types[a] != LXW_STAGING_AGGREGATE_COUNT
+            && table->columns[agg_cols[a]].type != LXW_STAGING_COLUMN_NUMBER)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    /* Keep the group table at most half full. */
+    while (num_slots / 2 < table->num_rows && num_slots < 0x80000000u)
+        num_slots *= 2;
+    mask = num_slots - 1;
+
+    /* Worst case every row is its own group. */
+    row_groups = (uint32_t *) malloc((table->num_rows + 1) *
+                                     sizeof(uint32_t));
+    group_rows = (uint32_t *) malloc((table->num_rows + 1) *
+                                     sizeof(uint32_t));
+    group_hashes = (uint32_t *) malloc((table->num_rows + 1) *
+                                       sizeof(uint32_t));
+    slots = (uint32_t *) calloc(num_slots, sizeof(uint32_t));
+    if (!row_groups || !group_rows || !group_hashes || !slots) {
+        err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        goto mem_error;
+    }
+
+    /* Assign every selected row to a group in the table's current
+     * order. */
+    for (i = 0; i < table->num_rows; i++) {
+        uint32_t row = table->order ? table->order[i] : i;
+        uint32_t hash;
+        uint32_t slot;
+
+        if (!staging_row_selected(table, row)) {
+            row_groups[row] = LV_NO_GROUP;
+            continue;
+        }
+
+        hash = staging_row_hash(table, key_cols, num_keys, row);
+
+        for (slot = hash & mask; slots[slot]; slot = (slot + 1) & mask) {
+            g = slots[slot] - 1;
+            if (group_hashes[g] == hash
+                && staging_rows_equal(table, key_cols, num_keys,
+                                      group_rows[g], row))
+                break;
+        }
+
+        if (!slots[slot]) {
+            g = num_groups++;
+            group_rows[g] = row;
+            group_hashes[g] = hash;
+            slots[slot] = g + 1;
+        }
+
+        row_groups[row] = g;
+    }
+
+    if (num_aggs) {
+        accs = (lv_group_acc *) calloc((size_t) num_groups * num_aggs + 1,
+                                       sizeof(lv_group_acc));
+        if (!accs) {
+            err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            goto mem_error;
+        }
+    }
+
+    /* Accumulate one aggregate at a time so each pass streams a single
+     * column in storage order. */
+    for (a = 0; a < num_aggs; a++) {
+        const lxw_staging_column *column = &table->columns[agg_cols[a]];
+
+        for (i = 0; i < table->num_rows; i++) {
+            lv_group_acc *acc;
+            double value;
+
+            if (row_groups[i] == LV_NO_GROUP
+                || staging_column_is_blank(column, i))
+                continue;
+
+            acc = &accs[(size_t) row_groups[i] * num_aggs + a];
+
+            if (column->type != LXW_STAGING_COLUMN_NUMBER) {
+                acc->count++;
+                continue;
+            }
+
+            value = column->numbers[i];
+
+            if (acc->count == 0 || value < acc->min)
+                acc->min = value;
+            if (acc->count == 0 || value > acc->max)
+                acc->max = value;
+
+            acc->sum += value;
+            acc->count++;
+        }
+    }
+
+    /* Write the summary block: a header row, then one row per group. */
+    for (k = 0; k < num_keys && !err; k++)
+        err = staging_write_header(table, worksheet, first_row,
+                                   first_col + k, "", key_cols[k],
+                                   header_format);
+
+    for (a = 0; a < num_aggs && !err; a++)
+        err = staging_write_header(table, worksheet, first_row,
+                                   first_col + num_keys + a,
+                                   staging_aggregate_names[agg_types[a]],
+                                   agg_cols[a], header_format);
+
+    for (g = 0; g < num_groups && !err; g++) {
+        lxw_row_t row = first_row + 1 + g;
+
+        for (k = 0; k < num_keys && !err; k++)
+            err = staging_write_cell(worksheet, row, first_col + k,
+                                     &table->columns[key_cols[k]],
+                                     group_rows[g], NULL);
+
+        for (a = 0; a < num_aggs && !err; a++) {
+            const lv_group_acc *acc = &accs[(size_t) g * num_aggs + a];
+            lxw_col_t col = first_col + num_keys + a;
+            double value;
+
+            if (agg_types[a] == LXW_STAGING_AGGREGATE_COUNT) {
+                err = worksheet_write_number(worksheet, row, col,
+                                             acc->count, NULL);
+                continue;
+            }
+
+            if (acc->count == 0)
+                continue;
+
+            switch (agg_types[a]) {
+                case LXW_STAGING_AGGREGATE_MIN:
+                    value = acc->min;
+                    break;
+                case LXW_STAGING_AGGREGATE_MAX:
+                    value = acc->max;
+                    break;
+                case LXW_STAGING_AGGREGATE_MEAN:
+                    value = acc->sum / acc->count;
+                    break;
+                default:
+                    value = acc->sum;
+                    break;
+            }
+
+            err = worksheet_write_number(worksheet, row, col, value,
+                                         number_format);
+        }
+    }
+
+    /* Optionally chart each aggregate against the first key column and
+     * place the chart to the right of the block. */
+    if (chart && !err && num_groups && num_aggs) {
+        for (a = 0; a < num_aggs; a++) {
+            lxw_col_t col = first_col + num_keys + a;
+            lxw_chart_series *series =
+                chart_add_series_impl(chart, NULL, NULL, 0);
+
+            if (!series) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                break;
+            }
+
+            chart_series_set_categories(series, worksheet->name,
+                                        first_row + 1, first_col,
+                                        first_row + num_groups, first_col);
+            chart_series_set_values(series, worksheet->name,
+                                    first_row + 1, col,
+                                    first_row + num_groups, col);
+            chart_series_set_name_range(series, worksheet->name,
+                                        first_row, col);
+        }
+
+        if (!err)
+            err = worksheet_insert_chart(worksheet, first_row,
+                                         first_col + num_keys + num_aggs + 1,
+                                         chart);
+    }
+
+    if (num_groups_out)
+        *num_groups_out = num_groups;
+
+mem_error:
+    free(row_groups);
+    free(group_rows);
+    free(group_hashes);
+    free(slots);
+    free(accs);
+    return err;
+}
+
+/*
+ * Row filter expressions.
+ *
+ * An expression such as
+ *
+ *     col3 > 5 and (col7 == "FAIL" or not col2 <= 1e-3)
+ *
+ * is compiled once into a postfix program of column comparisons and boolean
+ * operators. Columns are referenced by 0-based index, string literals are
+ * double quoted with \" and \\ escapes, and "and", "or", "not" may also be
+ * written "&&", "||", "!". Blank cells compare as the empty string and fail
+ * every numeric comparison.
+ *
+ * Selection evaluates the program over whole columns, producing one bit per
+ * row, 64 rows per word, and combines the bitmaps with word-wide boolean
+ * operations. String comparisons are evaluated once per distinct string in
+ * the column's dictionary and then looked up per row.
+ *
+ * The parser is recursive descent, so "not" and parentheses may only be
+ * nested LV_FILTER_MAX_NESTING deep; deeper expressions are a syntax error
+ * rather than a stack overflow.
+ */
+#define LV_FILTER_MAX_NESTING 256
+
+enum lv_filter_op_type {
+    LV_FILTER_OP_COMPARE,
+    LV_FILTER_OP_AND,
+    LV_FILTER_OP_OR,
+    LV_FILTER_OP_NOT
+};
+
+enum lv_filter_cmp {
+    LV_FILTER_CMP_EQ,
+    LV_FILTER_CMP_NE,
+    LV_FILTER_CMP_LT,
+    LV_FILTER_CMP_LE,
+    LV_FILTER_CMP_GT,
+    LV_FILTER_CMP_GE
+};
+
+typedef struct lv_filter_op {
+    uint8_t type;
+    uint8_t cmp;
+    uint16_t col;
+
+    /* Literal: a string if string is not NULL, otherwise number. */
+    char *string;
+    double number;
+} lv_filter_op;
+
+typedef struct lxw_staging_filter {
+    lv_filter_op *ops;
+    uint32_t num_ops;
+    uint32_t max_depth;
+    lv_arena arena;
+} lxw_staging_filter;
+
+typedef struct lv_filter_parser {
+    const char *start;
+    const char *pos;
+    lxw_staging_filter *filter;
+    uint32_t capacity;
+    uint32_t depth;
+    uint32_t nesting;
+    int failed;
+} lv_filter_parser;
+
+static void
+filter_skip_space(lv_filter_parser *parser)
+{
+    while (*parser->pos == ' ' || *parser->pos == '\t'
+           || *parser->pos == '\r' || *parser->pos == '\n')
+        parser->pos++;
+}
+
+/* Match a keyword or symbol, requiring a word boundary after keywords. */
+static int
+filter_accept(lv_filter_parser *parser, const char *word, const char *symbol)
+{
+    size_t len = strlen(word);
+    char next;
+
+    filter_skip_space(parser);
+
+    if (symbol && strncmp(parser->pos, symbol, strlen(symbol)) == 0) {
+        parser->pos += strlen(symbol);
+        return 1;
+    }
+
+    if (strncmp(parser->pos, word, len) != 0)
+        return 0;
+
+    next = parser->pos[len];
+    if ((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z')
+        || (next >= '0' && next <= '9') || next == '_')
+        return 0;
+
+    parser->pos += len;
+    return 1;
+}
+
+static lv_filter_op *
+filter_push(lv_filter_parser *parser, uint8_t type)
+{
+    lxw_staging_filter *filter = parser->filter;
+
+    if (filter->num_ops == parser->capacity) {
+        uint32_t capacity = parser->capacity ? parser->capacity * 2 : 16;
+        lv_filter_op *ops = (lv_filter_op *) realloc(filter->ops,
+                                                     capacity *
+                                                     sizeof(lv_filter_op));
+        if (!ops) {
+            parser->failed = 1;
+            return NULL;
+        }
+
+        filter->ops = ops;
+        parser->capacity = capacity;
+    }
+
+    memset(&filter->ops[filter->num_ops], 0, sizeof(lv_filter_op));
+    filter->ops[filter->num_ops].type = type;
+
+    /* Track the bitmap stack depth needed to evaluate the program. */
+    if (type == LV_FILTER_OP_COMPARE) {
+        parser->depth++;
+        if (parser->depth > filter->max_depth)
+            filter->max_depth = parser->depth;
+    }
+    else if (type != LV_FILTER_OP_NOT) {
+        parser->depth--;
+    }
+
+    return &filter->ops[filter->num_ops++];
+}
+
+static int filter_parse_or(lv_filter_parser *parser);
+
+static int
+filter_parse_compare(lv_filter_parser *parser)
+{
+    static const struct {
+        const char *symbol;
+        uint8_t cmp;
+    } cmps[] = {
+        {"==", LV_FILTER_CMP_EQ}, {"!=", LV_FILTER_CMP_NE},
+        {"<>", LV_FILTER_CMP_NE}, {"<=", LV_FILTER_CMP_LE},
+        {">=", LV_FILTER_CMP_GE}, {"=", LV_FILTER_CMP_EQ},
+        {"<", LV_FILTER_CMP_LT}, {">", LV_FILTER_CMP_GT}
+    };
+    lv_filter_op *op;
+    unsigned long col;
+    char *end;
+    size_t i;
+
+    filter_skip_space(parser);
+
+    if (strncmp(parser->pos, "col", 3) != 0
+        || parser->pos[3] < '0' || parser->pos[3] > '9')
+        return 0;
+
+    col = strtoul(parser->pos + 3, &end, 10);
+    if (col > 0xFFFF)
+        return 0;
+    parser->pos = end;
+
+    op = filter_push(parser, LV_FILTER_OP_COMPARE);
+    if (!op)
+        return 0;
+    op->col = (uint16_t) col;
+
+    filter_skip_space(parser);
+
+    for (i = 0; i < sizeof(cmps) / sizeof(cmps[0]); i++) {
+        size_t len = strlen(cmps[i].symbol);
+
+        if (strncmp(parser->pos, cmps[i].symbol, len) == 0) {
+            op->cmp = cmps[i].cmp;
+            parser->pos += len;
+            break;
+        }
+    }
+
+    if (i == sizeof(cmps) / sizeof(cmps[0]))
+        return 0;
+
+    filter_skip_space(parser);
+
+    if (*parser->pos == '"') {
+        const char *p = ++parser->pos;
+        char *out;
+
+        /* Unescaped length is at most the quoted length. */
+        while (*p && *p != '"') {
+            if (*p == '\\' && p[1])
+                p++;
+            p++;
+        }
+        if (*p != '"')
+            return 0;
+
+        out = (char *) arena_alloc(&parser->filter->arena,
+                                   p - parser->pos + 1);
+        if (!out) {
+            parser->failed = 1;
+            return 0;
+        }
+        op->string = out;
+
+        for (; parser->pos < p; parser->pos++) {
+            if (*parser->pos == '\\')
+                parser->pos++;
+            *out++ = *parser->pos;
+        }
+        *out = '\0';
+        parser->pos++;
+    }
+    else {
+        op->number = strtod(parser->pos, &end);
+        if (end == parser->pos)
+            return 0;
+        parser->pos = end;
+    }
+
+    return 1;
+}
+
+static int
+filter_parse_unary(lv_filter_parser *parser)
+{
+    const char *pos;
+
+    filter_skip_space(parser);
+    pos = parser->pos;
+
+    if (filter_accept(parser, "not", "!")) {
+        if (parser->nesting == LV_FILTER_MAX_NESTING) {
+            parser->pos = pos;
+            return 0;
+        }
+
+        parser->nesting++;
+        if (!filter_parse_unary(parser))
+            return 0;
+        parser->nesting--;
+
+        return filter_push(parser, LV_FILTER_OP_NOT) != NULL;
+    }
+
+    if (*parser->pos == '(') {
+        if (parser->nesting == LV_FILTER_MAX_NESTING)
+            return 0;
+
+        parser->pos++;
+        parser->nesting++;
+        if (!filter_parse_or(parser))
+            return 0;
+        parser->nesting--;
+
+        filter_skip_space(parser);
+        if (*parser->pos != ')')
+            return 0;
+        parser->pos++;
+        return 1;
+    }
+
+    return filter_parse_compare(parser);
+}
+
+static int
+filter_parse_and(lv_filter_parser *parser)
+{
+    if (!filter_parse_unary(parser))
+        return 0;
+
+    while (filter_accept(parser, "and", "&&")) {
+        if (!filter_parse_unary(parser))
+            return 0;
+        if (!filter_push(parser, LV_FILTER_OP_AND))
+            return 0;
+    }
+
+    return 1;
+}
+
+static int
+filter_parse_or(lv_filter_parser *parser)
+{
+    if (!filter_parse_and(parser))
+        return 0;
+
+    while (filter_accept(parser, "or", "||")) {
+        if (!filter_parse_and(parser))
+            return 0;
+        if (!filter_push(parser, LV_FILTER_OP_OR))
+            return 0;
+    }
+
+    return 1;
+}
+
+void
+staging_filter_free_lv(lxw_staging_filter *filter)
+{
+    if (!filter)
+        return;
+
+    free(filter->ops);
+    arena_free(&filter->arena);
+    free(filter);
+}
+
+lxw_staging_filter *
+staging_filter_compile_lv(const char *expression, int32_t *error_offset)
+{
+    lv_filter_parser parser = { 0 };
+    lxw_staging_filter *filter;
+    char *utf8;
+    int ok;
+
+    if (error_offset)
+        *error_offset = -1;
+
+    if (!expression)
+        return NULL;
+
+    filter = (lxw_staging_filter *) calloc(1, sizeof(lxw_staging_filter));
+    if (!filter)
+        return NULL;
+
+    utf8 = ansi_to_utf8(expression);
+
+    parser.start = utf8 ? utf8 : expression;
+    parser.pos = parser.start;
+    parser.filter = filter;
+
+    ok = filter_parse_or(&parser);
+    filter_skip_space(&parser);
+
+    if (!ok || parser.failed || *parser.pos) {
+        if (error_offset)
+            *error_offset = (int32_t) (parser.pos - parser.start);
+        staging_filter_free_lv(filter);
+        filter = NULL;
+    }
+
+    free(utf8);
+    return filter;
+}
+
+static int
+filter_compare_result(uint8_t cmp, int order)
+{
+    switch (cmp) {
+        case LV_FILTER_CMP_EQ:
+            return order == 0;
+        case LV_FILTER_CMP_NE:
+            return order != 0;
+        case LV_FILTER_CMP_LT:
+            return order < 0;
+        case LV_FILTER_CMP_LE:
+            return order <= 0;
+        case LV_FILTER_CMP_GT:
+            return order > 0;
+        default:
+            return order >= 0;
+    }
+}
+
+/* Evaluate one comparison over every row into a bitmap. */
+static lxw_error
+filter_eval_compare(const lxw_staging_table *table, const lv_filter_op *op,
+                    uint64_t *bits)
+{
+    const lxw_staging_column *column = &table->columns[op->col];
+    uint32_t num_words = (table->num_rows + 63) / 64;
+    uint8_t *matches = NULL;
+    uint8_t blank_match;
+    uint32_t w;
+
+    if (op->string) {
+        blank_match = (uint8_t) filter_compare_result(op->cmp,
+                                                      strcmp("", op->string));
+    }
+    else {
+        blank_match = 0;
+    }
+
+    if (column->type == LXW_STAGING_COLUMN_STRING && op->string) {
+        uint32_t i;
+
+        matches = (uint8_t *) malloc(column->dict.count + 1);
+        if (!matches)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        for (i = 0; i < column->dict.count; i++)
+            matches[i] = (uint8_t) filter_compare_result(op->cmp,
+                                                         strcmp(column->dict.
+                                                                strings[i],
+                                                                op->string));
+    }
+
+    for (w = 0; w < num_words; w++) {
+        uint32_t base = w * 64;
+        uint32_t end = base + 64 < table->num_rows ? base + 64 :
+            table->num_rows;
+        uint64_t word = 0;
+        uint32_t row;
+
+        for (row = base; row < end; row++) {
+            int match;
+
+            if (staging_column_is_blank(column, row))
+                match = blank_match;
+            else if (matches)
+                match = matches[column->ids[row]];
+            else if (column->type == LXW_STAGING_COLUMN_NUMBER
+                     && !op->string) {
+                double value = column->numbers[row];
+                match = filter_compare_result(op->cmp,
+                                              (value > op->number) -
+                                              (value < op->number));
+            }
+            else {
+                /* Mismatched types are never equal. */
+                match = op->cmp == LV_FILTER_CMP_NE;
+            }
+
+            word |= (uint64_t) match << (row - base);
+        }
+
+        bits[w] = word;
+    }
+
+    free(matches);
+    return LXW_NO_ERROR;
+}
+
+lxw_error
+staging_table_select_lv(lxw_staging_table *table,
+                        lxw_staging_filter *filter,
+                        uint32_t *num_selected_out)
+{
+    uint32_t num_words;
+    uint64_t *stack;
+    uint32_t depth = 0;
+    uint32_t i, w;
+    uint32_t num_selected = 0;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (num_selected_out)
+        *num_selected_out = 0;
+
+    if (!table || !filter)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    for (i = 0; i < filter->num_ops; i++) {
+        if (filter->ops[i].type == LV_FILTER_OP_COMPARE
+            && filter->ops[i].col >= table->num_cols)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    num_words = (table->num_rows + 63) / 64;
+
+    stack = (uint64_t *) malloc(((size_t) filter->max_depth * num_words + 1)
+                                * sizeof(uint64_t));
+    if (!stack)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    for (i = 0; i < filter->num_ops && !err; i++) {
+        const lv_filter_op *op = &filter->ops[i];
+        uint64_t *top = stack + (size_t) depth * num_words;
+        uint64_t *last = top - num_words;
+        uint64_t *prev = last - num_words;
+
+        switch (op->type) {
+            case LV_FILTER_OP_COMPARE:
+                err = filter_eval_compare(table, op, top);
+                depth++;
+                break;
+            case LV_FILTER_OP_NOT:
+                for (w = 0; w < num_words; w++)
+                    last[w] = ~last[w];
+                break;
+            case LV_FILTER_OP_AND:
+                for (w = 0; w < num_words; w++)
+                    prev[w] &= last[w];
+                depth--;
+                break;
+            default:
+                for (w = 0; w < num_words; w++)
+                    prev[w] |= last[w];
+                depth--;
+                break;
+        }
+    }
+
+    if (err) {
+        free(stack);
+        return err;
+    }
+
+    /* Clear the bits past the last row set by NOT, then count. */
+    if (num_words && table->num_rows % 64)
+        stack[num_words - 1] &= (1ull << (table->num_rows % 64)) - 1;
+
+    for (w = 0; w < num_words; w++) {
+        uint64_t word = stack[w];
+
+        while (word) {
+            word &= word - 1;
+            num_selected++;
+        }
+    }
+
+    /* Keep only the result bitmap. */
+    free(table->selection);
+    table->selection = (uint64_t *) realloc(stack, (num_words + 1) *
+                                            sizeof(uint64_t));
+    if (!table->selection)
+        table->selection = stack;
+
+    if (num_selected_out)
+        *num_selected_out = num_selected;
+
+    return LXW_NO_ERROR;
+}
+
+void
+staging_table_select_all_lv(lxw_staging_table *table)
+{
+    if (!table)
+        return;
+
+    free(table->selection);
+    table->selection = NULL;
+}
+
+/*
+ * Autofilters with hidden rows.
+ *
+ * worksheet_filter_column() only records the filter criteria; Excel does
+ * not re-apply a filter on open, so rows that don't match must also be
+ * hidden for the file to open filtered. These functions record the
+ * criteria like worksheet_filter_column_lv()/worksheet_filter_column2_lv()
+ * and then evaluate them against the staged data last written by
+ * staging_table_emit_lv(), hiding every non-matching row. Filtering
+ * several columns hides the union of their non-matching rows.
+ *
+ * String criteria match like Excel: case-insensitive, with * and ?
+ * wildcards for "equal to" and "not equal to".
+ */
+static int
+ascii_tolower(int c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+static int
+ascii_strcasecmp(const char *a, const char *b)
+{
+    while (*a && ascii_tolower((unsigned char) *a) ==
+           ascii_tolower((unsigned char) *b)) {
+        a++;
+        b++;
+    }
+
+    return ascii_tolower((unsigned char) *a) -
+        ascii_tolower((unsigned char) *b);
+}
+
+static int
+wildcard_match(const char *pattern, const char *str)
+{
+    const char *star = NULL;
+    const char *resume = NULL;
+
+    while (*str) {
+        if (*pattern == '?'
+            || (*pattern && *pattern != '*'
+                && ascii_tolower((unsigned char) *pattern) ==
+                ascii_tolower((unsigned char) *str))) {
+            pattern++;
+            str++;
+        }
+        else if (*pattern == '*') {
+            star = pattern++;
+            resume = str;
+        }
+        else if (star) {
+            pattern = star + 1;
+            str = ++resume;
+        }
+        else {
+            return 0;
+        }
+    }
+
+    while (*pattern == '*')
+        pattern++;
+
+    return !*pattern;
+}
+
+/* Evaluate one rule against a cell. str is NULL for number cells. */
+static int
+autofilter_rule_match(const lxw_filter_rule *rule, int is_blank,
+                      const char *str, double number)
+{
+    int order;
+
+    if (rule->criteria == LXW_FILTER_CRITERIA_BLANKS)
+        return is_blank;
+    if (rule->criteria == LXW_FILTER_CRITERIA_NON_BLANKS)
+        return !is_blank;
+    if (rule->criteria == LXW_FILTER_CRITERIA_NONE)
+        return 1;
+
+    if (rule->value_string) {
+        if (is_blank)
+            str = "";
+
+        if (!str) {
+            /* Number cell against a string criterion. */
+            char *end;
+            double value = strtod(rule->value_string, &end);
+
+            if (end == rule->value_string || *end)
+                return rule->criteria == LXW_FILTER_CRITERIA_NOT_EQUAL_TO;
+
+            order = (number > value) - (number < value);
+        }
+        else if (rule->criteria == LXW_FILTER_CRITERIA_EQUAL_TO) {
+            return wildcard_match(rule->value_string, str);
+        }
+        else if (rule->criteria == LXW_FILTER_CRITERIA_NOT_EQUAL_TO) {
+            return !wildcard_match(rule->value_string, str);
+        }
+        else {
+            order = ascii_strcasecmp(str, rule->value_string);
+        }
+    }
+    else {
+        if (is_blank || str)
+            return rule->criteria == LXW_FILTER_CRITERIA_NOT_EQUAL_TO;
+
+        order = (number > rule->value) - (number < rule->value);
+    }
+
+    switch (rule->criteria) {
+        case LXW_FILTER_CRITERIA_EQUAL_TO:
+            return order == 0;
+        case LXW_FILTER_CRITERIA_NOT_EQUAL_TO:
+            return order != 0;
+        case LXW_FILTER_CRITERIA_GREATER_THAN:
+            return order > 0;
+        case LXW_FILTER_CRITERIA_LESS_THAN:
+            return order < 0;
+        case LXW_FILTER_CRITERIA_GREATER_THAN_OR_EQUAL_TO:
+            return order >= 0;
+        case LXW_FILTER_CRITERIA_LESS_THAN_OR_EQUAL_TO:
+            return order <= 0;
+        default:
+            return 1;
+    }
+}
+
+static int
+autofilter_cell_match(const lxw_filter_rule *rule,
+                      const lxw_staging_column *column, uint32_t row)
+{
+    int is_blank = staging_column_is_blank(column, row);
+
+    if (column->type == LXW_STAGING_COLUMN_STRING)
+        return autofilter_rule_match(rule, is_blank,
+                                     is_blank ? "" :
+                                     staging_cell_string(column, row), 0);
+    else
+        return autofilter_rule_match(rule, is_blank, NULL,
+                                     is_blank ? 0 : column->numbers[row]);
+}
+
+/* Hide the emitted rows that fail the rules. rule2 may be NULL. */
+static lxw_error
+staging_table_hide_unmatched(lxw_staging_table *table, lxw_col_t col,
+                             const lxw_filter_rule *rule1,
+                             const lxw_filter_rule *rule2, uint8_t and_or,
+                             uint32_t *num_hidden_out)
+{
+    const lxw_staging_column *column;
+    lxw_row_col_options hidden = { 0 };
+    uint32_t num_hidden = 0;
+    uint32_t i;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!table->emit_worksheet)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if (col < table->emit_first_col
+        || col - table->emit_first_col >= table->num_cols)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    column = &table->columns[col - table->emit_first_col];
+
+    if (!table->emit_hidden) {
+        table->emit_hidden =
+            (uint64_t *) calloc(table->emit_count / 64 + 1,
+                                sizeof(uint64_t));
+        if (!table->emit_hidden)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    hidden.hidden = 1;
+
+    for (i = 0; i < table->emit_count && !err; i++) {
+        uint32_t row = table->emit_rows[i];
+        int match = autofilter_cell_match(rule1, column, row);
+
+        if (rule2) {
+            int match2 = autofilter_cell_match(rule2, column, row);
+            match = and_or == LXW_FILTER_OR ? match || match2 :
+                match && match2;
+        }
+
+        if (match || (table->emit_hidden[i / 64] >> (i % 64)) & 1)
+            continue;
+
+        err = worksheet_set_row_opt(table->emit_worksheet,
+                                    table->emit_first_row + i,
+                                    LXW_DEF_ROW_HEIGHT, NULL, &hidden);
+
+        table->emit_hidden[i / 64] |= 1ull << (i % 64);
+        num_hidden++;
+    }
+
+    if (num_hidden_out)
+        *num_hidden_out = num_hidden;
+
+    return err;
+}
+
+lxw_error
+staging_table_filter_column_lv(lxw_staging_table *table, lxw_col_t col,
+                               uint8_t criteria, const char *value_string,
+                               double value, uint32_t *num_hidden_out)
+{
+    lxw_filter_rule rule = { 0 };
+    char *utf8 = NULL;
+    lxw_error err;
+
+    if (num_hidden_out)
+        *num_hidden_out = 0;
+
+    if (!table || !table->emit_worksheet)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    err = worksheet_filter_column_lv(table->emit_worksheet, col, criteria,
+                                     value_string, value);
+    if (err)
+        return err;
+
+    rule.criteria = criteria;
+    rule.value = value;
+
+    if (value_string && *value_string) {
+        utf8 = ansi_to_utf8(value_string);
+        rule.value_string = utf8 ? utf8 : value_string;
+    }
+
+    err = staging_table_hide_unmatched(table, col, &rule, NULL, 0,
+                                       num_hidden_out);
+    free(utf8);
+    return err;
+}
+
+lxw_error
+staging_table_filter_column2_lv(lxw_staging_table *table, lxw_col_t col,
+                                uint8_t criteria1, const char *value_string1,
+                                double value1, uint8_t criteria2,
+                                const char *value_string2, double value2,
+                                uint8_t and_or, uint32_t *num_hidden_out)
+{
+    lxw_filter_rule rule1 = { 0 };
+    lxw_filter_rule rule2 = { 0 };
+    char *utf8_1 = NULL;
+    char *utf8_2 = NULL;
+    lxw_error err;
+
+    if (num_hidden_out)
+        *num_hidden_out = 0;
+
+    if (!table || !table->emit_worksheet)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    err = worksheet_filter_column2_lv(table->emit_worksheet, col, criteria1,
+                                      value_string1, value1, criteria2,
+                                      value_string2, value2, and_or);
+    if (err)
+        return err;
+
+    rule1.criteria = criteria1;
+    rule1.value = value1;
+    rule2.criteria = criteria2;
+    rule2.value = value2;
+
+    if (value_string1 && *value_string1) {
+        utf8_1 = ansi_to_utf8(value_string1);
+        rule1.value_string = utf8_1 ? utf8_1 : value_string1;
+    }
+
+    if (value_string2 && *value_string2) {
+        utf8_2 = ansi_to_utf8(value_string2);
+        rule2.value_string = utf8_2 ? utf8_2 : value_string2;
+    }
+
+    err = staging_table_hide_unmatched(table, col, &rule1, &rule2, and_or,
+                                       num_hidden_out);
+    free(utf8_1);
+    free(utf8_2);
+    return err;
+}
+
+/* ============================================================================
+ * Typed numeric array functions
+ * ============================================================================ */
+
+/*
+ * Element types for the typed numeric writers, so that integer and SGL
+ * data can be written without first converting the array to DBL.
+ */
+enum lxw_numeric_type {
+    LXW_NUMERIC_I8 = 0,
+    LXW_NUMERIC_I16,
+    LXW_NUMERIC_I32,
+    LXW_NUMERIC_I64,
+    LXW_NUMERIC_U8,
+    LXW_NUMERIC_U16,
+    LXW_NUMERIC_U32,
+    LXW_NUMERIC_U64,
+    LXW_NUMERIC_SGL,
+    LXW_NUMERIC_DBL
+};
+
+static size_t
+numeric_type_size(uint8_t type)
+{
+    switch (type) {
+        case LXW_NUMERIC_I8:
+        case LXW_NUMERIC_U8:
+            return 1;
+        case LXW_NUMERIC_I16:
+        case LXW_NUMERIC_U16:
+            return 2;
+        case LXW_NUMERIC_I32:
+        case LXW_NUMERIC_U32:
+        case LXW_NUMERIC_SGL:
+            return 4;
+        case LXW_NUMERIC_I64:
+        case LXW_NUMERIC_U64:
+        case LXW_NUMERIC_DBL:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+#define NUMERIC_CONVERT(ctype)                                               \
+    do {                                                                     \
+        const ctype *in = (const ctype *) src;                               \
+        for (i = 0; i < count; i++)                                          \
+            dst[i] = (double) in[i] * scale + offset;                        \
+    } while (0)
+
+/* Convert count elements of src to doubles as value * scale + offset. */
+static void
+numeric_to_double(double *dst, const void *src, uint8_t type, size_t count,
+                  double scale, double offset)
+{
+    size_t i;
+
+    switch (type) {
+        case LXW_NUMERIC_I8:
+            NUMERIC_CONVERT(int8_t);
+            break;
+        case LXW_NUMERIC_I16:
+            NUMERIC_CONVERT(int16_t);
+            break;
+        case LXW_NUMERIC_I32:
+            NUMERIC_CONVERT(int32_t);
+            break;
+        case LXW_NUMERIC_I64:
+            NUMERIC_CONVERT(int64_t);
+            break;
+        case LXW_NUMERIC_U8:
+            NUMERIC_CONVERT(uint8_t);
+            break;
+        case LXW_NUMERIC_U16:
+            NUMERIC_CONVERT(uint16_t);
+            break;
+        case LXW_NUMERIC_U32:
+            NUMERIC_CONVERT(uint32_t);
+            break;
+        case LXW_NUMERIC_U64:
+            NUMERIC_CONVERT(uint64_t);
+            break;
+        case LXW_NUMERIC_SGL:
+            NUMERIC_CONVERT(float);
+            break;
+        case LXW_NUMERIC_DBL:
+            NUMERIC_CONVERT(double);
+            break;
+    }
+}
+
+#undef NUMERIC_CONVERT
+
+/*
+ * Write a row-major 2D array of num_rows x num_cols elements of the given
+ * lxw_numeric_type. scales and offsets are optional per-column arrays of
+ * num_cols values (NULL for 1 and 0). Each row is converted into a small
+ * DBL buffer just before it is written, so no full DBL copy of the data is
+ * made. NaN and infinite values are left blank.
+ */
+lxw_error
+worksheet_write_numeric_array_lv(lxw_worksheet *worksheet,
+                                 lxw_row_t first_row, lxw_col_t first_col,
+                                 const void *data, uint8_t data_type,
+                                 uint32_t num_rows, uint16_t num_cols,
+                                 const double *scales, const double *offsets,
+                                 lxw_format *format)
+{
+    size_t elem_size = numeric_type_size(data_type);
+    const uint8_t *row_data = (const uint8_t *) data;
+    double *values;
+    uint32_t row;
+    uint16_t col;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!worksheet || !data || num_rows == 0 || num_cols == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (elem_size == 0)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if ((uint64_t) first_row + num_rows > LXW_ROW_MAX
+        || (uint32_t) first_col + num_cols > LXW_COL_MAX)
+        return LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+
+    values = (double *) malloc(num_cols * sizeof(double));
+    if (!values)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    for (row = 0; row < num_rows && !err; row++) {
+        numeric_to_double(values, row_data, data_type, num_cols, 1.0, 0.0);
+        row_data += elem_size * num_cols;
+
+        for (col = 0; col < num_cols && !err; col++) {
+            double value = values[col];
+
+            if (scales)
+                value *= scales[col];
+            if (offsets)
+                value += offsets[col];
+
+            if (!isfinite(value))
+                continue;
+
+            err = worksheet_write_number(worksheet, first_row + row,
+                                         (lxw_col_t) (first_col + col), value,
+                                         format);
+        }
+    }
+
+    free(values);
+    return err;
+}
+
+/* Append typed values to a number column as value * scale + offset. */
+lxw_error
+staging_table_append_numeric_lv(lxw_staging_table *table, lxw_col_t col,
+                                const void *values, uint8_t data_type,
+                                uint32_t count, double scale, double offset)
+{
+    lxw_staging_column *column;
+    lxw_error err;
+
+    if (!table || !values || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (numeric_type_size(data_type) == 0 || col >= table->num_cols
+        || table->columns[col].type != LXW_STAGING_COLUMN_NUMBER)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    column = &table->columns[col];
+
+    err = staging_column_reserve(column, count);
+    if (err)
+        return err;
+
+    numeric_to_double(column->numbers + column->num_rows, values, data_type,
+                      count, scale, offset);
+    column->num_rows += count;
+
+    staging_table_rows_appended(table, column);
+    return LXW_NO_ERROR;
+}
+
+/*
+ * Write a row-major 2D boolean array of num_rows x num_cols. With packed
+ * = 0 data is a LabVIEW boolean array, one byte per element (non-zero is
+ * TRUE). With packed = 1 it is a bitset holding the elements one after
+ * the other, least significant bit of each byte first.
+ *
+ * With as_checkbox = 1 the cells are written as checkboxes: via
+ * worksheet_insert_checkbox() when format is NULL, otherwise the format is
+ * turned into a checkbox format so alignment, fill etc. can be combined
+ * with the checkbox.
+ */
+lxw_error
+worksheet_write_boolean_array_lv(lxw_worksheet *worksheet,
+                                 lxw_row_t first_row, lxw_col_t first_col,
+                                 const uint8_t *data, uint8_t packed,
+                                 uint32_t num_rows, uint16_t num_cols,
+                                 lxw_format *format, uint8_t as_checkbox)
+{
+    size_t index = 0;
+    uint32_t row;
+    uint16_t col;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!worksheet || !data || num_rows == 0 || num_cols == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if ((uint64_t) first_row + num_rows > LXW_ROW_MAX
+        || (uint32_t) first_col + num_cols > LXW_COL_MAX)
+        return LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+
+    if (as_checkbox && format)
+        format_set_checkbox(format);
+
+    for (row = 0; row < num_rows && !err; row++) {
+        for (col = 0; col < num_cols && !err; col++, index++) {
+            uint8_t value = packed ? (data[index / 8] >> (index % 8)) & 1 :
+                data[index] != 0;
+
+            if (as_checkbox && !format)
+                err = worksheet_insert_checkbox(worksheet, first_row + row,
+                                                (lxw_col_t) (first_col + col),
+                                                value);
+            else
+                err = worksheet_write_boolean(worksheet, first_row + row,
+                                              (lxw_col_t) (first_col + col),
+                                              value, format);
+        }
+    }
+
+    return err;
+}
+
+/* ============================================================================
+ * Cluster array functions
+ * ============================================================================ */
+
+/*
+ * A LabVIEW 1D array of any element type, passed as "Adapt to Type" with
+ * "Handles by Value". The element data follows dim_size, aligned to the
+ * element alignment on platforms that align cluster data.
+ */
+typedef struct lv_array {
+    int32_t dim_size;
+} lv_array, **lv_array_handle;
+
+/*
+ * LabVIEW aligns cluster elements naturally except in 32-bit Windows,
+ * where cluster data is packed.
+ */
+#if defined(_WIN32) && !defined(_WIN64)
+#define LV_PACKED_CLUSTERS 1
+#else
+#define LV_PACKED_CLUSTERS 0
+#endif
+
+/* Type codes used in LabVIEW type descriptors. */
+#define LV_TD_I8        0x01
+#define LV_TD_DBL       0x0A
+#define LV_TD_ENUM_U8   0x15
+#define LV_TD_ENUM_U16  0x16
+#define LV_TD_ENUM_U32  0x17
+#define LV_TD_BOOLEAN   0x21
+#define LV_TD_STRING    0x30
+#define LV_TD_ARRAY     0x40
+#define LV_TD_CLUSTER   0x50
+#define LV_TD_MEASURE   0x54
+#define LV_TD_HAS_LABEL 0x40
+
+/* Flavor of the 0x54 measure type used for 128-bit timestamps. */
+#define LV_TD_TIMESTAMP_FLAVOR 6
+
+/* Excel serial date of the LabVIEW epoch, 1904-01-01 00:00 UTC. */
+#define LV_EPOCH_EXCEL_DATE 1462.0
+
+enum lv_field_kind {
+    LV_FIELD_NUMBER,
+    LV_FIELD_ENUM,
+    LV_FIELD_BOOLEAN,
+    LV_FIELD_STRING,
+    LV_FIELD_TIMESTAMP
+};
+
+/* A scalar cluster element, written to one worksheet column. */
+typedef struct lv_field {
+    uint8_t kind;
+    uint8_t numeric_type;
+    uint32_t offset;
+    char *label;
+    char **enum_labels;
+    uint16_t num_enum_labels;
+} lv_field;
+
+typedef struct lv_td_parser {
+    const uint8_t *td;
+    size_t size;
+    lv_field *fields;
+    uint16_t num_fields;
+    uint16_t capacity;
+    lv_arena *arena;
+} lv_td_parser;
+
+/* Type descriptors are parsed in their flattened, big-endian form. */
+static uint16_t
+td_u16(const lv_td_parser *parser, size_t pos)
+{
+    const uint8_t *p = parser->td + pos;
+
+    return (uint16_t) (p[0] << 8 | p[1]);
+}
+
+static uint32_t
+align_up(uint32_t offset, uint32_t align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+/*
+ * Read the label of a type descriptor, if it has one. Labels are a Pascal
+ * string at the end of the descriptor, after the type specific data that
+ * ends at pos. Descriptors with data the parser doesn't understand, such
+ * as numerics with units, simply report no label.
+ */
+static char *
+td_label(lv_td_parser *parser, uint8_t flags, size_t pos, size_t end)
+{
+    size_t len;
+
+    if (!(flags & LV_TD_HAS_LABEL) || pos >= end)
+        return NULL;
+
+    len = parser->td[pos];
+    if (pos + 1 + len != end && pos + 2 + len != end)
+        return NULL;
+
+    return arena_utf8(parser->arena, (const char *) parser->td + pos + 1,
+                      (int32_t) len);
+}
+
+/* Append a field. A cluster can't have more scalar fields than a worksheet
+ * has columns. */
+static lxw_error
+td_add_field(lv_td_parser *parser, uint8_t kind, uint8_t numeric_type,
+             lv_field **field_out)
+{
+    lv_field *field;
+
+    if (parser->num_fields == parser->capacity) {
+        uint16_t capacity = parser->capacity ? parser->capacity * 2 : 16;
+        lv_field *fields;
+
+        if (parser->capacity >= LXW_COL_MAX)
+            return LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+
+        fields = (lv_field *) realloc(parser->fields,
+                                      capacity * sizeof(lv_field));
+        if (!fields)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        parser->fields = fields;
+        parser->capacity = capacity;
+    }
+
+    field = &parser->fields[parser->num_fields++];
+    memset(field, 0, sizeof(lv_field));
+    field->kind = kind;
+    field->numeric_type = numeric_type;
+    *field_out = field;
+    return LXW_NO_ERROR;
+}
+
+/*
+ * Parse the type descriptor at pos, appending its scalar fields with
+ * offsets relative to the start of the element. Returns the element size
+ * and alignment in LabVIEW's in-memory layout.
+ */
+static lxw_error
+td_parse(lv_td_parser *parser, size_t pos, uint32_t *size_out,
+         uint32_t *align_out)
+{
+    static const uint8_t numeric_types[] = {
+        LXW_NUMERIC_I8, LXW_NUMERIC_I16, LXW_NUMERIC_I32, LXW_NUMERIC_I64,
+        LXW_NUMERIC_U8, LXW_NUMERIC_U16, LXW_NUMERIC_U32, LXW_NUMERIC_U64,
+        LXW_NUMERIC_SGL, LXW_NUMERIC_DBL
+    };
+    lv_field *field;
+    size_t end;
+    size_t body;
+    uint8_t flags;
+    uint8_t code;
+    uint32_t size;
+    lxw_error err;
+
+    if (pos + 4 > parser->size)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    end = pos + td_u16(parser, pos);
+    flags = parser->td[pos + 2];
+    code = parser->td[pos + 3];
+    body = pos + 4;
+
+    if (end < body || end > parser->size)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if (code >= LV_TD_I8 && code <= LV_TD_DBL) {
+        uint8_t type = numeric_types[code - LV_TD_I8];
+
+        err = td_add_field(parser, LV_FIELD_NUMBER, type, &field);
+        if (err)
+            return err;
+
+        field->label = td_label(parser, flags, body, end);
+        size = (uint32_t) numeric_type_size(type);
+    }
+    else if (code >= LV_TD_ENUM_U8 && code <= LV_TD_ENUM_U32) {
+        uint16_t i;
+
+        err = td_add_field(parser, LV_FIELD_ENUM,
+                           code == LV_TD_ENUM_U8 ? LXW_NUMERIC_U8 :
+                           code == LV_TD_ENUM_U16 ? LXW_NUMERIC_U16 :
+                           LXW_NUMERIC_U32, &field);
+        if (err)
+            return err;
+
+        if (body + 2 > end)
+            return LXW_ERROR_PARAMETER_VALIDATION;
+
+        field->num_enum_labels = td_u16(parser, body);
+        field->enum_labels =
+            (char **) arena_alloc(parser->arena,
+                                  (field->num_enum_labels + 1) *
+                                  sizeof(char *));
+        if (!field->enum_labels)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        body += 2;
+        for (i = 0; i < field->num_enum_labels; i++) {
+            size_t len;
+
+            if (body >= end || body + 1 + parser->td[body] > end)
+                return LXW_ERROR_PARAMETER_VALIDATION;
+
+            len = parser->td[body];
+            field->enum_labels[i] =
+                arena_utf8(parser->arena, (const char *) parser->td + body + 1,
+                           (int32_t) len);
+            if (!field->enum_labels[i])
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+            body += 1 + len;
+        }
+
+        /* The label list is padded to an even length. */
+        if ((body - pos) % 2)
+            body++;
+
+        field->label = td_label(parser, flags, body, end);
+        size = (uint32_t) numeric_type_size(field->numeric_type);
+    }
+    else if (code == LV_TD_BOOLEAN) {
+        err = td_add_field(parser, LV_FIELD_BOOLEAN, 0, &field);
+        if (err)
+            return err;
+
+        field->label = td_label(parser, flags, body, end);
+        size = 1;
+    }
+    else if (code == LV_TD_STRING) {
+        err = td_add_field(parser, LV_FIELD_STRING, 0, &field);
+        if (err)
+            return err;
+
+        field->label = td_label(parser, flags, body + 4, end);
+        size = sizeof(lv_str_handle);
+    }
+    else if (code == LV_TD_MEASURE && body + 2 <= end
+             && td_u16(parser, body) == LV_TD_TIMESTAMP_FLAVOR) {
+        err = td_add_field(parser, LV_FIELD_TIMESTAMP, 0, &field);
+        if (err)
+            return err;
+
+        field->label = td_label(parser, flags, body + 2, end);
+        *size_out = 16;
+        *align_out = LV_PACKED_CLUSTERS ? 1 : 8;
+        return LXW_NO_ERROR;
+    }
+    else if (code == LV_TD_CLUSTER && body + 2 <= end) {
+        uint16_t num_elements = td_u16(parser, body);
+        uint32_t offset = 0;
+        uint32_t cluster_align = 1;
+        uint16_t i;
+
+        body += 2;
+        for (i = 0; i < num_elements; i++) {
+            uint16_t first = parser->num_fields;
+            uint32_t elem_size;
+            uint32_t elem_align;
+            uint16_t j;
+
+            if (body + 2 > end)
+                return LXW_ERROR_PARAMETER_VALIDATION;
+
+            err = td_parse(parser, body, &elem_size, &elem_align);
+            if (err)
+                return err;
+
+            offset = align_up(offset, elem_align);
+            for (j = first; j < parser->num_fields; j++)
+                parser->fields[j].offset += offset;
+
+            offset += elem_size;
+            if (elem_align > cluster_align)
+                cluster_align = elem_align;
+
+            body += td_u16(parser, body);
+        }
+
+        *size_out = align_up(offset, cluster_align);
+        *align_out = cluster_align;
+        return LXW_NO_ERROR;
+    }
+    else {
+        /* Arrays inside clusters, EXT, complex, variants, refnums etc. */
+        return LXW_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    *size_out = size;
+    *align_out = LV_PACKED_CLUSTERS ? 1 : size;
+    return LXW_NO_ERROR;
+}
+
+static lxw_error
+cluster_write_field(lxw_worksheet *worksheet, lxw_row_t row, lxw_col_t col,
+                    const lv_field *field, const uint8_t *data,
+                    lv_arena *arena, lxw_format *date_format)
+{
+    const uint8_t *p = data + field->offset;
+
+    switch (field->kind) {
+        case LV_FIELD_BOOLEAN:
+            return worksheet_write_boolean(worksheet, row, col, *p != 0,
+                                           NULL);
+
+        case LV_FIELD_STRING:{
+            lv_str_handle handle;
+            const char *utf8;
+            size_t utf8_len;
+
+            memcpy(&handle, p, sizeof(handle));
+            if (!handle || !*handle || (*handle)->cnt <= 0)
+                return LXW_NO_ERROR;
+
+            utf8 = arena_scratch_utf8(arena, (*handle)->str, (*handle)->cnt,
+                                      &utf8_len);
+            if (!utf8)
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+            return worksheet_write_string(worksheet, row, col, utf8, NULL);
+        }
+
+        case LV_FIELD_TIMESTAMP:{
+            /* In memory a timestamp is { u64 fraction; i64 seconds }. */
+            uint64_t fraction;
+            int64_t seconds;
+            double days;
+
+            memcpy(&fraction, p, sizeof(fraction));
+            memcpy(&seconds, p + 8, sizeof(seconds));
+
+            if (seconds == 0 && fraction == 0)
+                return LXW_NO_ERROR;
+
+            days = ((double) seconds + (double) fraction / 18446744073709551616.0)
+                / 86400.0 + LV_EPOCH_EXCEL_DATE;
+
+            return worksheet_write_number(worksheet, row, col, days,
+                                          date_format);
+        }
+
+        default:{
+            uint64_t raw = 0;
+            double value;
+
+            memcpy(&raw, p, numeric_type_size(field->numeric_type));
+            numeric_to_double(&value, &raw, field->numeric_type, 1, 1.0, 0.0);
+
+            if (field->kind == LV_FIELD_ENUM && value < field->num_enum_labels)
+                return worksheet_write_string(worksheet, row, col,
+                                              field->enum_labels[(size_t)
+                                                                 value],
+                                              NULL);
+
+            if (!isfinite(value))
+                return LXW_NO_ERROR;
+
+            return worksheet_write_number(worksheet, row, col, value, NULL);
+        }
+    }
+}
+
+/*
+ * Write an array of clusters, one row per element and one column per
+ * scalar cluster element, with nested clusters flattened in order.
+ *
+ * type_desc is the type descriptor of the array or of its cluster
+ * element: the I16 array returned by Variant To Flattened String with
+ * i16_array = 1, or the legacy Flatten To String type string with
+ * i16_array = 0. type_desc_size is its number of elements. The layout is
+ * parsed once and the element data read in place using LabVIEW's
+ * alignment rules for the platform.
+ *
+ * Enums are written as their item text and timestamps (UTC) as Excel
+ * dates with date_format. With write_header the element labels are
+ * written in a header row first.
+ */
+lxw_error
+worksheet_write_cluster_array_lv(lxw_worksheet *worksheet,
+                                 lxw_row_t first_row, lxw_col_t first_col,
+                                 const void *type_desc,
+                                 int32_t type_desc_size, uint8_t i16_array,
+                                 lv_array_handle array, uint8_t write_header,
+                                 lxw_format *header_format,
+                                 lxw_format *date_format,
+                                 uint32_t *num_rows_out)
+{
+    lv_arena arena = { 0 };
+    lv_td_parser parser = { 0 };
+    const uint8_t *data;
+    size_t pos = 0;
+    uint32_t elem_size;
+    uint32_t elem_align;
+    uint32_t num_elements;
+    uint32_t i;
+    uint16_t j;
+    lxw_error err;
+
+    if (num_rows_out)
+        *num_rows_out = 0;
+
+    if (!worksheet || !type_desc || type_desc_size < (i16_array ? 2 : 4))
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    parser.td = (const uint8_t *) type_desc;
+    parser.size = (size_t) type_desc_size * (i16_array ? 2 : 1);
+    parser.arena = &arena;
+
+    /* I16 words hold the flattened bytes in host order. */
+    if (i16_array) {
+        const uint16_t probe = 1;
+
+        if (*(const uint8_t *) &probe) {
+            uint8_t *td = (uint8_t *) arena_alloc(&arena, parser.size);
+            size_t k;
+
+            if (!td)
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+            for (k = 0; k < parser.size; k += 2) {
+                td[k] = parser.td[k + 1];
+                td[k + 1] = parser.td[k];
+            }
+
+            parser.td = td;
+        }
+    }
+
+    /* Step into the element type of a 1D array descriptor. */
+    if (parser.td[3] == LV_TD_ARRAY) {
+        if (parser.size < 10 || td_u16(&parser, 4) != 1) {
+            err = LXW_ERROR_PARAMETER_VALIDATION;
+            goto done;
+        }
+
+        pos = 10;
+    }
+
+    err = td_parse(&parser, pos, &elem_size, &elem_align);
+    if (err)
+        goto done;
+
+    if (parser.num_fields == 0 || elem_size == 0) {
+        err = LXW_ERROR_PARAMETER_VALIDATION;
+        goto done;
+    }
+
+    num_elements = array && *array && (*array)->dim_size > 0 ?
+        (uint32_t) (*array)->dim_size : 0;
+
+    if ((uint32_t) first_col + parser.num_fields > LXW_COL_MAX
+        || (uint64_t) first_row + num_elements + (write_header ? 1 : 0) >
+        LXW_ROW_MAX) {
+        err = LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+        goto done;
+    }
+
+    if (write_header) {
+        for (j = 0; j < parser.num_fields && !err; j++) {
+            if (parser.fields[j].label && *parser.fields[j].label)
+                err = worksheet_write_string(worksheet, first_row,
+                                             (lxw_col_t) (first_col + j),
+                                             parser.fields[j].label,
+                                             header_format);
+        }
+
+        first_row++;
+    }
+
+    if (num_elements == 0)
+        goto done;
+
+    data = (const uint8_t *) *array + align_up(sizeof(int32_t), elem_align);
+
+    for (i = 0; i < num_elements && !err; i++, data += elem_size) {
+        for (j = 0; j < parser.num_fields && !err; j++)
+            err = cluster_write_field(worksheet, first_row + i,
+                                      (lxw_col_t) (first_col + j),
+                                      &parser.fields[j], data, &arena,
+                                      date_format);
+    }
+
+    if (!err && num_rows_out)
+        *num_rows_out = num_elements;
+
+done:
+    free(parser.fields);
+    arena_free(&arena);
+    return err;
+}
+
+/* ============================================================================
+ * Label table functions
+ * ============================================================================ */
+
+/*
+ * Text for the items of an enum or ring, transcoded to UTF-8 once when the
+ * table is created so that index columns can be written as text without
+ * any per-cell conversion.
+ */
+typedef struct lxw_label_table {
+    char **labels;
+    size_t *lengths;
+    uint32_t num_labels;
+    lv_arena arena;
+} lxw_label_table;
+
+lxw_label_table *
+label_table_new_lv(lv_str_array_handle labels)
+{
+    lxw_label_table *table;
+    int32_t num_labels = lv_str_array_size(labels);
+    int32_t i;
+
+    if (num_labels == 0)
+        return NULL;
+
+    table = (lxw_label_table *) calloc(1, sizeof(lxw_label_table));
+    if (!table)
+        return NULL;
+
+    table->num_labels = (uint32_t) num_labels;
+    table->labels = (char **) arena_alloc(&table->arena,
+                                          num_labels * sizeof(char *));
+    table->lengths = (size_t *) arena_alloc(&table->arena,
+                                            num_labels * sizeof(size_t));
+    if (!table->labels || !table->lengths)
+        goto mem_error;
+
+    for (i = 0; i < num_labels; i++) {
+        int32_t len;
+        const char *label = lv_str_array_get(labels, i, &len);
+        const char *utf8 = arena_scratch_utf8(&table->arena, label, len,
+                                              &table->lengths[i]);
+
+        if (!utf8)
+            goto mem_error;
+
+        table->labels[i] = arena_strndup(&table->arena, utf8,
+                                         table->lengths[i]);
+        if (!table->labels[i])
+            goto mem_error;
+    }
+
+    return table;
+
+mem_error:
+    arena_free(&table->arena);
+    free(table);
+    return NULL;
+}
+
+void
+label_table_free_lv(lxw_label_table *table)
+{
+    if (!table)
+        return;
+
+    arena_free(&table->arena);
+    free(table);
+}
+
+/* Read element i of an integer array as an index. Negative values and
+ * non-integer types return UINT64_MAX, which is never a valid index. */
+static uint64_t
+numeric_index(const void *data, uint8_t type, size_t i)
+{
+    switch (type) {
+        case LXW_NUMERIC_I8:
+            return ((const int8_t *) data)[i] < 0 ? UINT64_MAX :
+                (uint64_t) ((const int8_t *) data)[i];
+        case LXW_NUMERIC_I16:
+            return ((const int16_t *) data)[i] < 0 ? UINT64_MAX :
+                (uint64_t) ((const int16_t *) data)[i];
+        case LXW_NUMERIC_I32:
+            return ((const int32_t *) data)[i] < 0 ? UINT64_MAX :
+                (uint64_t) ((const int32_t *) data)[i];
+        case LXW_NUMERIC_I64:
+            return ((const int64_t *) data)[i] < 0 ? UINT64_MAX :
+                (uint64_t) ((const int64_t *) data)[i];
+        case LXW_NUMERIC_U8:
+            return ((const uint8_t *) data)[i];
+        case LXW_NUMERIC_U16:
+            return ((const uint16_t *) data)[i];
+        case LXW_NUMERIC_U32:
+            return ((const uint32_t *) data)[i];
+        case LXW_NUMERIC_U64:
+            return ((const uint64_t *) data)[i];
+        default:
+            return UINT64_MAX;
+    }
+}
+
+/*
+ * Write a column of enum or ring values as their label text. indices is
+ * an integer array of the given lxw_numeric_type. Values outside the
+ * label table are written as numbers and empty labels are left blank.
+ */
+lxw_error
+worksheet_write_labels_lv(lxw_worksheet *worksheet, lxw_row_t first_row,
+                          lxw_col_t col, const void *indices,
+                          uint8_t data_type, uint32_t count,
+                          lxw_label_table *labels, lxw_format *format)
+{
+    uint32_t i;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!worksheet || !indices || !labels || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (data_type > LXW_NUMERIC_U64)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if ((uint64_t) first_row + count > LXW_ROW_MAX || col >= LXW_COL_MAX)
+        return LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+
+    for (i = 0; i < count && !err; i++) {
+        uint64_t index = numeric_index(indices, data_type, i);
+
+        if (index < labels->num_labels) {
+            if (labels->lengths[index])
+                err = worksheet_write_string(worksheet, first_row + i, col,
+                                             labels->labels[index], format);
+        }
+        else {
+            double value;
+
+            numeric_to_double(&value, (const uint8_t *) indices +
+                              i * numeric_type_size(data_type), data_type, 1,
+                              1.0, 0.0);
+            err = worksheet_write_number(worksheet, first_row + i, col,
+                                         value, format);
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Append enum or ring values to a string column as their label text. Each
+ * label is interned in the column once, so rows are appended by index
+ * lookup alone. Values outside the label table are appended as blanks.
+ */
+lxw_error
+staging_table_append_labels_lv(lxw_staging_table *table, lxw_col_t col,
+                               const void *indices, uint8_t data_type,
+                               uint32_t count, lxw_label_table *labels)
+{
+    lxw_staging_column *column;
+    uint32_t *label_ids;
+    uint32_t i;
+    lxw_error err;
+
+    if (!table || !indices || !labels || count == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (data_type > LXW_NUMERIC_U64 || col >= table->num_cols
+        || table->columns[col].type != LXW_STAGING_COLUMN_STRING)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    column = &table->columns[col];
+
+    err = staging_column_reserve(column, count);
+    if (err)
+        return err;
+
+    label_ids = (uint32_t *) malloc(labels->num_labels * sizeof(uint32_t));
+    if (!label_ids)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    for (i = 0; i < labels->num_labels; i++) {
+        label_ids[i] = LXW_STAGING_BLANK;
+
+        if (labels->lengths[i]) {
+            label_ids[i] = dict_intern(&column->dict, &table->arena,
+                                       labels->labels[i], labels->lengths[i]);
+            if (label_ids[i] == LV_DICT_NOT_FOUND) {
+                free(label_ids);
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        uint64_t index = numeric_index(indices, data_type, i);
+
+        column->ids[column->num_rows++] = index < labels->num_labels ?
+            label_ids[index] : LXW_STAGING_BLANK;
+    }
+
+    free(label_ids);
+    staging_table_rows_appended(table, column);
+    return LXW_NO_ERROR;
+}
+
+/* ============================================================================
+ * TDMS conversion functions
+ * ============================================================================ */
+
+/* A read-only memory mapping of a whole file. */
+typedef struct lv_mapped_file {
+    const uint8_t *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} lv_mapped_file;
+
+static lxw_error
+mapped_file_open(lv_mapped_file *mapped, const char *filename)
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    mapped->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapped->file == INVALID_HANDLE_VALUE)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if (!GetFileSizeEx(mapped->file, &size) || size.QuadPart <= 0
+        || (uint64_t) size.QuadPart > SIZE_MAX) {
+        CloseHandle(mapped->file);
+        return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY,
+                                         0, 0, NULL);
+    if (!mapped->mapping) {
+        CloseHandle(mapped->file);
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    mapped->data = (const uint8_t *) MapViewOfFile(mapped->mapping,
+                                                   FILE_MAP_READ, 0, 0, 0);
+    if (!mapped->data) {
+        CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    mapped->size = (size_t) size.QuadPart;
+#else
+    struct stat st;
+    void *data;
+
+    mapped->fd = open(filename, O_RDONLY);
+    if (mapped->fd < 0)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    if (fstat(mapped->fd, &st) || st.st_size <= 0
+        || (uint64_t) st.st_size > SIZE_MAX) {
+        close(mapped->fd);
+        return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+                mapped->fd, 0);
+    if (data == MAP_FAILED) {
+        close(mapped->fd);
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    mapped->data = (const uint8_t *) data;
+    mapped->size = (size_t) st.st_size;
+#endif
+
+    return LXW_NO_ERROR;
+}
+
+static void
+mapped_file_close(lv_mapped_file *mapped)
+{
+    if (!mapped->data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+#else
+    munmap((void *) mapped->data, mapped->size);
+    close(mapped->fd);
+#endif
+
+    mapped->data = NULL;
+}
+
+/* Segment lead-in and table of contents flags. */
+#define TDMS_LEAD_IN_SIZE       28
+#define TDMS_TOC_META_DATA      (1u << 1)
+#define TDMS_TOC_NEW_OBJ_LIST   (1u << 2)
+#define TDMS_TOC_RAW_DATA       (1u << 3)
+#define TDMS_TOC_INTERLEAVED    (1u << 5)
+#define TDMS_TOC_BIG_ENDIAN     (1u << 6)
+
+/* Special raw data index values. */
+#define TDMS_NO_RAW_DATA        0xFFFFFFFFu
+#define TDMS_SAME_RAW_INDEX     0x00000000u
+#define TDMS_DAQMX_INDEX        0x69120000u
+#define TDMS_DAQMX_DIGITAL      0x69130000u
+
+#define TDMS_NO_GROUP           0xFFFFFFFFu
+
+enum tdms_data_type {
+    TDMS_TYPE_I8 = 0x01,
+    TDMS_TYPE_I16 = 0x02,
+    TDMS_TYPE_I32 = 0x03,
+    TDMS_TYPE_I64 = 0x04,
+    TDMS_TYPE_U8 = 0x05,
+    TDMS_TYPE_U16 = 0x06,
+    TDMS_TYPE_U32 = 0x07,
+    TDMS_TYPE_U64 = 0x08,
+    TDMS_TYPE_SGL = 0x09,
+    TDMS_TYPE_DBL = 0x0A,
+    TDMS_TYPE_EXT = 0x0B,
+    TDMS_TYPE_SGL_UNIT = 0x19,
+    TDMS_TYPE_DBL_UNIT = 0x1A,
+    TDMS_TYPE_EXT_UNIT = 0x1B,
+    TDMS_TYPE_STRING = 0x20,
+    TDMS_TYPE_BOOLEAN = 0x21,
+    TDMS_TYPE_TIMESTAMP = 0x44,
+    TDMS_TYPE_COMPLEX_SGL = 0x08000C,
+    TDMS_TYPE_COMPLEX_DBL = 0x10000D
+};
+
+/* Size of a fixed size value, or 0 for strings and unknown types. */
+static uint32_t
+tdms_type_size(uint32_t type)
+{
+    switch (type) {
+        case TDMS_TYPE_I8:
+        case TDMS_TYPE_U8:
+        case TDMS_TYPE_BOOLEAN:
+            return 1;
+        case TDMS_TYPE_I16:
+        case TDMS_TYPE_U16:
+            return 2;
+        case TDMS_TYPE_I32:
+        case TDMS_TYPE_U32:
+        case TDMS_TYPE_SGL:
+        case TDMS_TYPE_SGL_UNIT:
+            return 4;
+        case TDMS_TYPE_I64:
+        case TDMS_TYPE_U64:
+        case TDMS_TYPE_DBL:
+        case TDMS_TYPE_DBL_UNIT:
+        case TDMS_TYPE_COMPLEX_SGL:
+            return 8;
+        case TDMS_TYPE_EXT:
+        case TDMS_TYPE_EXT_UNIT:
+        case TDMS_TYPE_TIMESTAMP:
+        case TDMS_TYPE_COMPLEX_DBL:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+/* Channel types that are written to the worksheet. */
+static int
+tdms_type_supported(uint32_t type)
+{
+    return (type >= TDMS_TYPE_I8 && type <= TDMS_TYPE_DBL)
+        || type == TDMS_TYPE_SGL_UNIT || type == TDMS_TYPE_DBL_UNIT
+        || type == TDMS_TYPE_STRING || type == TDMS_TYPE_BOOLEAN
+        || type == TDMS_TYPE_TIMESTAMP;
+}
+
+static int
+tdms_type_is_number(uint32_t type)
+{
+    return (type >= TDMS_TYPE_I8 && type <= TDMS_TYPE_DBL)
+        || type == TDMS_TYPE_SGL_UNIT || type == TDMS_TYPE_DBL_UNIT;
+}
+
+/* Load an unsigned integer of up to 8 bytes in the given byte order. */
+static uint64_t
+tdms_load(const uint8_t *p, uint32_t size, uint8_t big_endian)
+{
+    uint64_t value = 0;
+    uint32_t i;
+
+    if (big_endian) {
+        for (i = 0; i < size; i++)
+            value = value << 8 | p[i];
+    }
+    else {
+        for (i = size; i > 0; i--)
+            value = value << 8 | p[i - 1];
+    }
+
+    return value;
+}
+
+/* Decode a numeric or boolean value. */
+static double
+tdms_number(const uint8_t *p, uint32_t type, uint8_t big_endian)
+{
+    uint64_t bits = tdms_load(p, tdms_type_size(type), big_endian);
+    uint32_t bits32 = (uint32_t) bits;
+    float sgl;
+    double dbl;
+
+    switch (type) {
+        case TDMS_TYPE_I8:
+            return (int8_t) bits;
+        case TDMS_TYPE_I16:
+            return (int16_t) bits;
+        case TDMS_TYPE_I32:
+            return (int32_t) bits;
+        case TDMS_TYPE_I64:
+            return (double) (int64_t) bits;
+        case TDMS_TYPE_SGL:
+        case TDMS_TYPE_SGL_UNIT:
+            memcpy(&sgl, &bits32, sizeof(sgl));
+            return sgl;
+        case TDMS_TYPE_DBL:
+        case TDMS_TYPE_DBL_UNIT:
+            memcpy(&dbl, &bits, sizeof(dbl));
+            return dbl;
+        case TDMS_TYPE_BOOLEAN:
+            return bits != 0;
+        default:
+            return (double) bits;
+    }
+}
+
+/* Decode a timestamp as an Excel date, or NaN for the zero timestamp. */
+static double
+tdms_timestamp(const uint8_t *p, uint8_t big_endian)
+{
+    uint64_t fraction = tdms_load(p + (big_endian ? 8 : 0), 8, big_endian);
+    int64_t seconds = (int64_t) tdms_load(p + (big_endian ? 0 : 8), 8,
+                                          big_endian);
+
+    if (seconds == 0 && fraction == 0)
+        return NAN;
+
+    return ((double) seconds + (double) fraction / 18446744073709551616.0)
+        / 86400.0 + LV_EPOCH_EXCEL_DATE;
+}
+
+typedef struct tdms_reader {
+    const uint8_t *data;
+    size_t pos;
+    size_t end;
+    uint8_t big_endian;
+    uint8_t error;
+} tdms_reader;
+
+static const uint8_t *
+tdms_read_bytes(tdms_reader *reader, size_t size)
+{
+    const uint8_t *p;
+
+    if (reader->error || size > reader->end - reader->pos) {
+        reader->error = 1;
+        return NULL;
+    }
+
+    p = reader->data + reader->pos;
+    reader->pos += size;
+    return p;
+}
+
+static uint32_t
+tdms_read_u32(tdms_reader *reader)
+{
+    const uint8_t *p = tdms_read_bytes(reader, 4);
+
+    return p ? (uint32_t) tdms_load(p, 4, reader->big_endian) : 0;
+}
+
+static uint64_t
+tdms_read_u64(tdms_reader *reader)
+{
+    const uint8_t *p = tdms_read_bytes(reader, 8);
+
+    return p ? tdms_load(p, 8, reader->big_endian) : 0;
+}
+
+static const char *
+tdms_read_string(tdms_reader *reader, uint32_t *len)
+{
+    *len = tdms_read_u32(reader);
+    return (const char *) tdms_read_bytes(reader, *len);
+}
+
+typedef struct tdms_property {
+    char *name;
+    uint32_t type;
+    double number;
+    char *string;
+} tdms_property;
+
+/*
+ * Where a channel's values are in the file: num_blocks blocks of count
+ * values, block_stride bytes apart, with value_stride bytes between the
+ * values of a block. String blocks start with count end offsets.
+ */
+typedef struct tdms_chunk {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t num_blocks;
+    uint64_t block_stride;
+    uint32_t value_stride;
+    uint8_t big_endian;
+} tdms_chunk;
+
+typedef struct tdms_object {
+    char *group;
+    char *channel;
+    uint32_t group_id;
+    uint32_t data_type;
+    uint64_t num_values;
+    uint64_t data_size;
+    uint8_t has_index;
+    uint8_t active;
+    uint8_t daqmx;
+    tdms_chunk *chunks;
+    uint32_t num_chunks;
+    uint32_t chunks_capacity;
+    tdms_property *properties;
+    uint32_t num_properties;
+    uint32_t properties_capacity;
+    uint64_t total_values;
+} tdms_object;
+
+typedef struct tdms_file {
+    lv_mapped_file mapped;
+    lv_arena arena;
+    lv_dict paths;
+    lv_dict groups;
+    tdms_object *objects;
+    uint32_t num_objects;
+    uint32_t objects_capacity;
+    uint32_t *active;
+    uint32_t num_active;
+    uint32_t active_capacity;
+} tdms_file;
+
+/* Split "/'group'/'channel'" into its unescaped names. */
+static char *
+tdms_path_name(tdms_file *tdms, const char **path, const char *end)
+{
+    const char *p = *path;
+    char *name;
+    size_t len = 0;
+
+    if (end - p < 3 || p[0] != '/' || p[1] != '\'')
+        return NULL;
+
+    name = (char *) arena_alloc(&tdms->arena, (size_t) (end - p));
+    if (!name)
+        return NULL;
+
+    for (p += 2; p < end; p++) {
+        if (*p == '\'') {
+            if (p + 1 < end && p[1] == '\'')
+                p++;
+            else
+                break;
+        }
+
+        name[len++] = *p;
+    }
+
+    name[len] = '\0';
+    *path = p < end ? p + 1 : end;
+    return name;
+}
+
+static tdms_object *
+tdms_get_object(tdms_file *tdms, const char *path, uint32_t len)
+{
+    uint32_t id = dict_intern(&tdms->paths, &tdms->arena, path, len);
+    tdms_object *object;
+    const char *p = path;
+
+    if (id == LV_DICT_NOT_FOUND)
+        return NULL;
+
+    if (id < tdms->num_objects)
+        return &tdms->objects[id];
+
+    if (tdms->num_objects == tdms->objects_capacity) {
+        uint32_t capacity = tdms->objects_capacity ?
+            tdms->objects_capacity * 2 : 64;
+        tdms_object *objects =
+            (tdms_object *) realloc(tdms->objects,
+                                    capacity * sizeof(tdms_object));
+        uint32_t *active =
+            (uint32_t *) realloc(tdms->active, capacity * sizeof(uint32_t));
+
+        if (objects)
+            tdms->objects = objects;
+        if (active)
+            tdms->active = active;
+        if (!objects || !active)
+            return NULL;
+
+        tdms->objects_capacity = capacity;
+        tdms->active_capacity = capacity;
+    }
+
+    object = &tdms->objects[tdms->num_objects++];
+    memset(object, 0, sizeof(tdms_object));
+    object->group_id = TDMS_NO_GROUP;
+    object->group = tdms_path_name(tdms, &p, path + len);
+    if (object->group)
+        object->channel = tdms_path_name(tdms, &p, path + len);
+
+    if (object->group) {
+        object->group_id = dict_intern(&tdms->groups, &tdms->arena,
+                                       object->group, strlen(object->group));
+        if (object->group_id == LV_DICT_NOT_FOUND)
+            return NULL;
+    }
+
+    return object;
+}
+
+static lxw_error
+tdms_read_property(tdms_file *tdms, tdms_reader *reader, tdms_object *object)
+{
+    tdms_property *property = NULL;
+    const char *name;
+    const char *string;
+    const uint8_t *value;
+    uint32_t name_len;
+    uint32_t len;
+    uint32_t type;
+    uint32_t i;
+
+    name = tdms_read_string(reader, &name_len);
+    type = tdms_read_u32(reader);
+    if (reader->error)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    for (i = 0; i < object->num_properties; i++) {
+        if (strlen(object->properties[i].name) == name_len
+            && memcmp(object->properties[i].name, name, name_len) == 0) {
+            property = &object->properties[i];
+            break;
+        }
+    }
+
+    if (!property) {
+        if (object->num_properties == object->properties_capacity) {
+            uint32_t capacity = object->properties_capacity ?
+                object->properties_capacity * 2 : 8;
+            tdms_property *properties =
+                (tdms_property *) realloc(object->properties,
+                                          capacity * sizeof(tdms_property));
+            if (!properties)
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+            object->properties = properties;
+            object->properties_capacity = capacity;
+        }
+
+        property = &object->properties[object->num_properties++];
+        property->name = arena_strndup(&tdms->arena, name, name_len);
+        if (!property->name)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+    }
+
+    property->type = type;
+    property->number = NAN;
+    property->string = NULL;
+
+    if (type == TDMS_TYPE_STRING) {
+        string = tdms_read_string(reader, &len);
+        if (string) {
+            property->string = arena_strndup(&tdms->arena, string, len);
+            if (!property->string)
+                return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+    }
+    else {
+        len = tdms_type_size(type);
+        if (len == 0)
+            return LXW_ERROR_FEATURE_NOT_SUPPORTED;
+
+        value = tdms_read_bytes(reader, len);
+        if (value && type == TDMS_TYPE_TIMESTAMP)
+            property->number = tdms_timestamp(value, reader->big_endian);
+        else if (value && len <= 8)
+            property->number = tdms_number(value, type, reader->big_endian);
+    }
+
+    return reader->error ? LXW_ERROR_PARAMETER_VALIDATION : LXW_NO_ERROR;
+}
+
+static void
+tdms_set_active(tdms_file *tdms, tdms_object *object, uint8_t active)
+{
+    uint32_t id = (uint32_t) (object - tdms->objects);
+    uint32_t i;
+
+    if (object->active == active)
+        return;
+
+    object->active = active;
+
+    if (active) {
+        tdms->active[tdms->num_active++] = id;
+        return;
+    }
+
+    for (i = 0; i < tdms->num_active; i++) {
+        if (tdms->active[i] == id) {
+            memmove(tdms->active + i, tdms->active + i + 1,
+                    (tdms->num_active - i - 1) * sizeof(uint32_t));
+            tdms->num_active--;
+            break;
+        }
+    }
+}
+
+/*
+ * Read the metadata of a segment: the objects, their raw data index and
+ * properties. Clears *raw_readable if the raw data layout of the segment
+ * can't be worked out, such as for DAQmx raw data.
+ */
+static lxw_error
+tdms_read_metadata(tdms_file *tdms, tdms_reader *reader, uint32_t toc,
+                   uint8_t *raw_readable)
+{
+    uint32_t num_objects;
+    uint32_t i;
+    uint32_t j;
+    lxw_error err;
+
+    if (toc & TDMS_TOC_NEW_OBJ_LIST) {
+        for (i = 0; i < tdms->num_active; i++)
+            tdms->objects[tdms->active[i]].active = 0;
+        tdms->num_active = 0;
+    }
+
+    num_objects = tdms_read_u32(reader);
+
+    for (i = 0; i < num_objects && !reader->error; i++) {
+        tdms_object *object;
+        const char *path;
+        uint32_t path_len;
+        uint32_t raw_index;
+        uint32_t num_properties;
+
+        path = tdms_read_string(reader, &path_len);
+        if (!path)
+            break;
+
+        object = tdms_get_object(tdms, path, path_len);
+        if (!object)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        raw_index = tdms_read_u32(reader);
+
+        if (raw_index == TDMS_NO_RAW_DATA) {
+            tdms_set_active(tdms, object, 0);
+        }
+        else if (raw_index == TDMS_SAME_RAW_INDEX) {
+            if (!object->has_index)
+                *raw_readable = 0;
+            tdms_set_active(tdms, object, 1);
+        }
+        else if (raw_index == TDMS_DAQMX_INDEX
+                 || raw_index == TDMS_DAQMX_DIGITAL) {
+            uint32_t count;
+
+            /* Skip the scalers and raw data widths. */
+            tdms_read_bytes(reader, 16);
+            count = tdms_read_u32(reader);
+            for (j = 0; j < count && !reader->error; j++)
+                tdms_read_bytes(reader, 17);
+            count = tdms_read_u32(reader);
+            for (j = 0; j < count && !reader->error; j++)
+                tdms_read_bytes(reader, 4);
+
+            object->daqmx = 1;
+            object->has_index = 0;
+            *raw_readable = 0;
+            tdms_set_active(tdms, object, 1);
+        }
+        else {
+            object->data_type = tdms_read_u32(reader);
+            tdms_read_u32(reader);
+            object->num_values = tdms_read_u64(reader);
+            object->data_size = object->data_type == TDMS_TYPE_STRING ?
+                tdms_read_u64(reader) :
+                object->num_values * tdms_type_size(object->data_type);
+            object->has_index = 1;
+
+            /* Reject layouts that can't fit, such as more string end
+             * offsets than the string data holds. */
+            if (object->num_values > UINT32_MAX
+                || (object->data_type == TDMS_TYPE_STRING ?
+                    object->data_size < object->num_values * 4 :
+                    tdms_type_size(object->data_type) == 0)) {
+                object->has_index = 0;
+                *raw_readable = 0;
+            }
+
+            tdms_set_active(tdms, object, 1);
+        }
+
+        num_properties = tdms_read_u32(reader);
+        for (j = 0; j < num_properties && !reader->error; j++) {
+            err = tdms_read_property(tdms, reader, object);
+            if (err)
+                return err;
+        }
+    }
+
+    return reader->error ? LXW_ERROR_PARAMETER_VALIDATION : LXW_NO_ERROR;
+}
+
+static lxw_error
+tdms_add_chunk(tdms_object *object, const tdms_chunk *chunk)
+{
+    tdms_chunk *last = object->num_chunks ?
+        &object->chunks[object->num_chunks - 1] : NULL;
+
+    object->total_values += chunk->count * chunk->num_blocks;
+
+    /* Extend the previous chunk if the values simply continue. */
+    if (last && last->num_blocks == 1 && chunk->num_blocks == 1
+        && last->value_stride && last->value_stride == chunk->value_stride
+        && last->big_endian == chunk->big_endian
+        && last->offset + last->count * last->value_stride == chunk->offset) {
+        last->count += chunk->count;
+        return LXW_NO_ERROR;
+    }
+
+    if (object->num_chunks == object->chunks_capacity) {
+        uint32_t capacity = object->chunks_capacity ?
+            object->chunks_capacity * 2 : 8;
+        tdms_chunk *chunks =
+            (tdms_chunk *) realloc(object->chunks,
+                                   capacity * sizeof(tdms_chunk));
+        if (!chunks)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        object->chunks = chunks;
+        object->chunks_capacity = capacity;
+    }
+
+    object->chunks[object->num_chunks++] = *chunk;
+    return LXW_NO_ERROR;
+}
+
+/* Record where each active channel's values are in the segment's raw
+ * data, which runs from start to end. */
+static lxw_error
+tdms_index_raw_data(tdms_file *tdms, uint64_t start, uint64_t end,
+                    uint32_t toc)
+{
+    uint64_t block_size = 0;
+    uint64_t offset = 0;
+    tdms_chunk chunk = { 0 };
+    uint32_t i;
+    lxw_error err;
+
+    for (i = 0; i < tdms->num_active; i++) {
+        const tdms_object *object = &tdms->objects[tdms->active[i]];
+
+        if (object->data_size > end - start)
+            return LXW_NO_ERROR;
+
+        block_size += toc & TDMS_TOC_INTERLEAVED ?
+            tdms_type_size(object->data_type) : object->data_size;
+    }
+
+    if (block_size == 0 || end <= start)
+        return LXW_NO_ERROR;
+
+    chunk.big_endian = (toc & TDMS_TOC_BIG_ENDIAN) != 0;
+
+    for (i = 0; i < tdms->num_active; i++) {
+        tdms_object *object = &tdms->objects[tdms->active[i]];
+        uint32_t size = tdms_type_size(object->data_type);
+
+        chunk.offset = start + offset;
+
+        if (toc & TDMS_TOC_INTERLEAVED) {
+            /* Strings can't be interleaved. */
+            if (size == 0)
+                return LXW_NO_ERROR;
+
+            chunk.count = (end - start) / block_size;
+            chunk.num_blocks = 1;
+            chunk.block_stride = 0;
+            chunk.value_stride = (uint32_t) block_size;
+            offset += size;
+        }
+        else {
+            chunk.count = object->num_values;
+            chunk.num_blocks = (end - start) / block_size;
+            chunk.block_stride = block_size;
+            chunk.value_stride = size;
+            offset += object->data_size;
+        }
+
+        if (chunk.count == 0 || chunk.num_blocks == 0)
+            continue;
+
+        err = tdms_add_chunk(object, &chunk);
+        if (err)
+            return err;
+    }
+
+    return LXW_NO_ERROR;
+}
+
+/* Walk the segments of the file, indexing objects and raw data. */
+static lxw_error
+tdms_read_file(tdms_file *tdms)
+{
+    const uint8_t *data = tdms->mapped.data;
+    uint64_t size = tdms->mapped.size;
+    uint64_t pos = 0;
+    lxw_error err;
+
+    while (size - pos >= TDMS_LEAD_IN_SIZE) {
+        const uint8_t *lead_in = data + pos;
+        uint32_t toc;
+        uint64_t next_offset;
+        uint64_t raw_offset;
+        uint64_t segment_end;
+        uint64_t raw_start;
+        uint8_t raw_readable = 1;
+        uint8_t big_endian;
+
+        if (memcmp(lead_in, "TDSm", 4) != 0)
+            return pos ? LXW_NO_ERROR : LXW_ERROR_PARAMETER_VALIDATION;
+
+        /* Only the ToC mask is always little-endian; the rest of the
+         * lead-in follows the segment's byte order. */
+        toc = (uint32_t) tdms_load(lead_in + 4, 4, 0);
+        big_endian = (toc & TDMS_TOC_BIG_ENDIAN) != 0;
+        next_offset = tdms_load(lead_in + 12, 8, big_endian);
+        raw_offset = tdms_load(lead_in + 20, 8, big_endian);
+
+        pos += TDMS_LEAD_IN_SIZE;
+
+        /* A segment still being written has no valid next offset. */
+        segment_end = next_offset > size - pos ? size : pos + next_offset;
+        raw_start = raw_offset > segment_end - pos ? segment_end :
+            pos + raw_offset;
+
+        if (toc & TDMS_TOC_META_DATA) {
+            tdms_reader reader = { 0 };
+
+            reader.data = data;
+            reader.pos = (size_t) pos;
+            reader.end = (size_t) raw_start;
+            reader.big_endian = big_endian;
+
+            err = tdms_read_metadata(tdms, &reader, toc, &raw_readable);
+            if (err)
+                return err;
+        }
+        else {
+            uint32_t i;
+
+            for (i = 0; i < tdms->num_active; i++) {
+                if (!tdms->objects[tdms->active[i]].has_index)
+                    raw_readable = 0;
+            }
+        }
+
+        if ((toc & TDMS_TOC_RAW_DATA) && raw_readable) {
+            err = tdms_index_raw_data(tdms, raw_start, segment_end, toc);
+            if (err)
+                return err;
+        }
+
+        pos = segment_end;
+    }
+
+    return LXW_NO_ERROR;
+}
+
+static void
+tdms_file_free(tdms_file *tdms)
+{
+    uint32_t i;
+
+    for (i = 0; i < tdms->num_objects; i++) {
+        free(tdms->objects[i].chunks);
+        free(tdms->objects[i].properties);
+    }
+
+    free(tdms->objects);
+    free(tdms->active);
+    dict_free(&tdms->paths);
+    dict_free(&tdms->groups);
+    arena_free(&tdms->arena);
+    mapped_file_close(&tdms->mapped);
+}
+
+/* Position of the next value to read from a channel. */
+typedef struct tdms_cursor {
+    uint32_t chunk;
+    uint64_t block;
+    uint64_t index;
+} tdms_cursor;
+
+/* Return the next value of a channel, or NULL at the end of its data.
+ * For strings *string_len is set and the string data is returned. */
+static const uint8_t *
+tdms_next_value(const tdms_file *tdms, const tdms_object *object,
+                tdms_cursor *cursor, uint8_t *big_endian,
+                uint32_t *string_len)
+{
+    const uint8_t *data = tdms->mapped.data;
+
+    while (cursor->chunk < object->num_chunks) {
+        const tdms_chunk *chunk = &object->chunks[cursor->chunk];
+        const uint8_t *block;
+        uint64_t index = cursor->index;
+
+        if (cursor->block >= chunk->num_blocks) {
+            cursor->chunk++;
+            cursor->block = 0;
+            cursor->index = 0;
+            continue;
+        }
+
+        block = data + chunk->offset + cursor->block * chunk->block_stride;
+        *big_endian = chunk->big_endian;
+
+        if (++cursor->index == chunk->count) {
+            cursor->index = 0;
+            cursor->block++;
+        }
+
+        if (object->data_type == TDMS_TYPE_STRING) {
+            /* Strings are a list of end offsets followed by the text. */
+            uint64_t start = index ?
+                tdms_load(block + (index - 1) * 4, 4, chunk->big_endian) : 0;
+            uint64_t end = tdms_load(block + index * 4, 4, chunk->big_endian);
+            uint64_t text = (uint64_t) (block - data) + chunk->count * 4;
+
+            if (end < start || text > tdms->mapped.size
+                || end > tdms->mapped.size - text)
+                return NULL;
+
+            *string_len = (uint32_t) (end - start);
+            return block + chunk->count * 4 + start;
+        }
+
+        return block + index * chunk->value_stride;
+    }
+
+    return NULL;
+}
+
+/* Formats and state shared while writing a converted workbook. */
+typedef struct tdms_writer {
+    lxw_workbook *workbook;
+    lxw_format *header_format;
+    lxw_format *date_format;
+    lv_arena arena;
+} tdms_writer;
+
+/*
+ * Add a worksheet named after a group, replacing characters that aren't
+ * allowed in sheet names, truncating to 31 characters and numbering it
+ * if the name is already in use.
+ */
+static lxw_worksheet *
+tdms_add_worksheet(tdms_writer *writer, const char *base, const char *suffix)
+{
+    char name[LXW_SHEETNAME_MAX * 4 + 1];
+    char number[16];
+    uint32_t n;
+
+    if (!base || !*base)
+        base = "Group";
+
+    for (n = 1; n < 1000; n++) {
+        size_t len = 0;
+        size_t chars = 0;
+        size_t max_chars;
+        const char *p;
+
+        if (n == 1)
+            number[0] = '\0';
+        else
+            snprintf(number, sizeof(number), " (%u)", (unsigned) n);
+
+        max_chars = LXW_SHEETNAME_MAX - strlen(suffix) - strlen(number);
+
+        for (p = base; *p; p++) {
+            unsigned char c = (unsigned char) *p;
+
+            if ((c & 0xC0) != 0x80 && chars++ == max_chars)
+                break;
+
+            name[len++] = strchr("[]:*?/\\", c) ? '_' : (char) c;
+        }
+
+        if (name[0] == '\'')
+            name[0] = '_';
+        if (name[len - 1] == '\'' && !*suffix && !*number)
+            name[len - 1] = '_';
+
+        snprintf(name + len, sizeof(name) - len, "%s%s", suffix, number);
+
+        if (!workbook_get_worksheet_by_name(writer->workbook, name))
+            return workbook_add_worksheet(writer->workbook, name);
+    }
+
+    return NULL;
+}
+
+static lxw_error
+tdms_write_property(tdms_writer *writer, lxw_worksheet *worksheet,
+                    lxw_row_t row, lxw_col_t col,
+                    const tdms_property *property)
+{
+    if (property->type == TDMS_TYPE_STRING)
+        return property->string && *property->string ?
+            worksheet_write_string(worksheet, row, col, property->string,
+                                   NULL) : LXW_NO_ERROR;
+
+    if (isnan(property->number) || isinf(property->number))
+        return LXW_NO_ERROR;
+
+    if (property->type == TDMS_TYPE_BOOLEAN)
+        return worksheet_write_boolean(worksheet, row, col,
+                                       property->number != 0, NULL);
+
+    return worksheet_write_number(worksheet, row, col, property->number,
+                                  property->type == TDMS_TYPE_TIMESTAMP ?
+                                  writer->date_format : NULL);
+}
+
+/*
+ * Write the header block of a group sheet: the group properties as name
+ * and value rows, one row per channel property with the values under each
+ * channel, then the channel names as the header of the data. Returns the
+ * number of rows written in *num_rows.
+ */
+static lxw_error
+tdms_write_header(tdms_writer *writer, lxw_worksheet *worksheet,
+                  const tdms_file *tdms, const tdms_object *group,
+                  const uint32_t *channels, uint16_t num_channels,
+                  lxw_row_t *num_rows)
+{
+    lv_dict names = { 0 };
+    lxw_row_t row = 0;
+    uint32_t i;
+    uint32_t name_id;
+    uint16_t c;
+    lxw_error err = LXW_NO_ERROR;
+
+    for (i = 0; group && i < group->num_properties && !err; i++, row++) {
+        err = worksheet_write_string(worksheet, row, 0,
+                                     group->properties[i].name,
+                                     writer->header_format);
+        if (!err)
+            err = tdms_write_property(writer, worksheet, row, 1,
+                                      &group->properties[i]);
+    }
+
+    if (row)
+        row++;
+
+    /* One row for each distinct channel property name. */
+    for (c = 0; c < num_channels && !err; c++) {
+        const tdms_object *channel = &tdms->objects[channels[c]];
+
+        for (i = 0; i < channel->num_properties; i++) {
+            const char *name = channel->properties[i].name;
+
+            if (dict_intern(&names, &writer->arena, name, strlen(name)) ==
+                LV_DICT_NOT_FOUND) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                break;
+            }
+        }
+    }
+
+    for (name_id = 0; name_id < names.count && !err; name_id++, row++) {
+        err = worksheet_write_string(worksheet, row, 0,
+                                     names.strings[name_id],
+                                     writer->header_format);
+
+        for (c = 0; c < num_channels && !err; c++) {
+            const tdms_object *channel = &tdms->objects[channels[c]];
+
+            for (i = 0; i < channel->num_properties; i++) {
+                if (strcmp(channel->properties[i].name,
+                           names.strings[name_id]) == 0) {
+                    err = tdms_write_property(writer, worksheet, row,
+                                              (lxw_col_t) (c + 1),
+                                              &channel->properties[i]);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!err)
+        err = worksheet_write_string(worksheet, row, 0, "Sample",
+                                     writer->header_format);
+
+    for (c = 0; c < num_channels && !err; c++)
+        err = worksheet_write_string(worksheet, row, (lxw_col_t) (c + 1),
+                                     tdms->objects[channels[c]].channel,
+                                     writer->header_format);
+
+    dict_free(&names);
+    *num_rows = row + 1;
+    return err;
+}
+
+static lxw_error
+tdms_write_value(tdms_writer *writer, lxw_worksheet *worksheet,
+                 lxw_row_t row, lxw_col_t col, uint32_t type,
+                 const uint8_t *value, uint8_t big_endian, uint32_t len)
+{
+    double number;
+
+    if (type == TDMS_TYPE_STRING) {
+        if (len == 0)
+            return LXW_NO_ERROR;
+
+        if (!arena_reserve_scratch(&writer->arena, (size_t) len + 1))
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        memcpy(writer->arena.scratch, value, len);
+        writer->arena.scratch[len] = '\0';
+        return worksheet_write_string(worksheet, row, col,
+                                      writer->arena.scratch, NULL);
+    }
+
+    if (type == TDMS_TYPE_BOOLEAN)
+        return worksheet_write_boolean(worksheet, row, col, *value != 0,
+                                       NULL);
+
+    if (type == TDMS_TYPE_TIMESTAMP) {
+        number = tdms_timestamp(value, big_endian);
+        return isnan(number) ? LXW_NO_ERROR :
+            worksheet_write_number(worksheet, row, col, number,
+                                   writer->date_format);
+    }
+
+    number = tdms_number(value, type, big_endian);
+    return isfinite(number) ?
+        worksheet_write_number(worksheet, row, col, number, NULL) :
+        LXW_NO_ERROR;
+}
+
+/*
+ * Convert one group: a worksheet with the header block and then one row
+ * per sample, continued on numbered sheets past Excel's row limit. With
+ * chart_points, every n-th sample of the numeric channels is also copied
+ * to a hidden sheet so that at most chart_points points are charted, and
+ * a line chart of them is inserted next to the data.
+ */
+static lxw_error
+tdms_write_group(tdms_writer *writer, const tdms_file *tdms,
+                 uint32_t group_id, uint32_t chart_points)
+{
+    const tdms_object *group = NULL;
+    const char *group_name = tdms->groups.strings[group_id];
+    lxw_worksheet *worksheet;
+    lxw_worksheet *chart_sheet = NULL;
+    lxw_worksheet *first_sheet;
+    tdms_cursor *cursors = NULL;
+    uint32_t *channels = NULL;
+    uint16_t num_channels = 0;
+    uint16_t num_numeric = 0;
+    uint64_t num_samples = 0;
+    uint64_t step = 1;
+    uint64_t sample;
+    lxw_row_t header_rows;
+    lxw_row_t row;
+    uint32_t i;
+    uint16_t c;
+    lxw_error err;
+
+    channels = (uint32_t *) calloc(tdms->num_objects, sizeof(uint32_t));
+    cursors = (tdms_cursor *) calloc(tdms->num_objects, sizeof(tdms_cursor));
+    if (!channels || !cursors) {
+        err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        goto done;
+    }
+
+    for (i = 0; i < tdms->num_objects; i++) {
+        const tdms_object *object = &tdms->objects[i];
+
+        if (object->group_id != group_id)
+            continue;
+
+        if (!object->channel) {
+            group = object;
+            continue;
+        }
+
+        if (object->daqmx || !tdms_type_supported(object->data_type)
+            || num_channels == LXW_COL_MAX - 1)
+            continue;
+
+        channels[num_channels++] = i;
+        if (tdms_type_is_number(object->data_type))
+            num_numeric++;
+        if (object->total_values > num_samples)
+            num_samples = object->total_values;
+    }
+
+    worksheet = tdms_add_worksheet(writer, group_name, "");
+    if (!worksheet) {
+        err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        goto done;
+    }
+
+    first_sheet = worksheet;
+
+    err = tdms_write_header(writer, worksheet, tdms, group, channels,
+                            num_channels, &header_rows);
+    if (err)
+        goto done;
+
+    if (chart_points && num_numeric && num_samples) {
+        uint16_t n = 0;
+
+        step = (num_samples + chart_points - 1) / chart_points;
+        chart_sheet = tdms_add_worksheet(writer, group_name, " chart");
+        if (!chart_sheet) {
+            err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            goto done;
+        }
+
+        worksheet_hide(chart_sheet);
+        err = worksheet_write_string(chart_sheet, 0, 0, "Sample", NULL);
+
+        for (c = 0; c < num_channels && !err; c++) {
+            const tdms_object *channel = &tdms->objects[channels[c]];
+
+            if (tdms_type_is_number(channel->data_type))
+                err = worksheet_write_string(chart_sheet, 0, ++n,
+                                             channel->channel, NULL);
+        }
+    }
+
+    row = header_rows;
+
+    for (sample = 0; sample < num_samples && !err; sample++, row++) {
+        uint8_t charted = chart_sheet && sample % step == 0;
+        lxw_row_t chart_row = (lxw_row_t) (sample / step + 1);
+        uint16_t n = 0;
+
+        if (row == LXW_ROW_MAX) {
+            worksheet = tdms_add_worksheet(writer, group_name, "");
+            if (!worksheet) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                break;
+            }
+
+            err = tdms_write_header(writer, worksheet, tdms, group, channels,
+                                    num_channels, &row);
+            if (err)
+                break;
+        }
+
+        err = worksheet_write_number(worksheet, row, 0, (double) sample,
+                                     NULL);
+        if (!err && charted)
+            err = worksheet_write_number(chart_sheet, chart_row, 0,
+                                         (double) sample, NULL);
+
+        for (c = 0; c < num_channels && !err; c++) {
+            const tdms_object *channel = &tdms->objects[channels[c]];
+            uint8_t big_endian = 0;
+            uint32_t len = 0;
+            const uint8_t *value =
+                tdms_next_value(tdms, channel, &cursors[c], &big_endian,
+                                &len);
+            uint8_t is_number = tdms_type_is_number(channel->data_type);
+
+            if (is_number)
+                n++;
+
+            if (!value)
+                continue;
+
+            err = tdms_write_value(writer, worksheet, row,
+                                   (lxw_col_t) (c + 1), channel->data_type,
+                                   value, big_endian, len);
+
+            if (!err && charted && is_number)
+                err = tdms_write_value(writer, chart_sheet, chart_row, n,
+                                       channel->data_type, value, big_endian,
+                                       0);
+        }
+    }
+
+    if (!err && chart_sheet) {
+        lxw_chart *chart = workbook_add_chart(writer->workbook,
+                                              LXW_CHART_LINE);
+        lxw_row_t last_row = (lxw_row_t) ((num_samples - 1) / step + 1);
+
+        if (!chart) {
+            err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            goto done;
+        }
+
+        for (c = 1; c <= num_numeric && c < 256; c++) {
+            lxw_chart_series *series =
+                chart_add_series_impl(chart, NULL, NULL, 0);
+
+            if (!series) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                goto done;
+            }
+
+            chart_series_set_categories(series, chart_sheet->name, 1, 0,
+                                        last_row, 0);
+            chart_series_set_values(series, chart_sheet->name, 1, c,
+                                    last_row, c);
+            chart_series_set_name_range(series, chart_sheet->name, 0, c);
+        }
+
+        err = worksheet_insert_chart(first_sheet, 0,
+                                     (lxw_col_t) (num_channels + 2), chart);
+    }
+
+done:
+    free(channels);
+    free(cursors);
+    return err;
+}
+
+/*
+ * Convert a TDMS file to an XLSX file with one worksheet per group. The
+ * file is memory mapped and its segments indexed once; each group is then
+ * streamed row by row in constant_memory mode, so memory use doesn't grow
+ * with the amount of data. Channels become columns after a "Sample" index
+ * column and properties form a header block above them.
+ *
+ * Numeric, boolean, string and timestamp channels are converted; DAQmx
+ * raw data and complex or extended precision channels are skipped, as are
+ * the file (root) properties. The whole file is mapped at once, so 32-bit
+ * builds are limited to files that fit in their address space.
+ */
+lxw_error
+tdms_convert_lv(const char *tdms_filename, const char *xlsx_filename,
+                uint32_t chart_points, uint32_t *num_groups_out)
+{
+    lxw_workbook_options options = { 0 };
+    tdms_file tdms = { 0 };
+    tdms_writer writer = { 0 };
+    uint32_t group_id;
+    lxw_error err;
+
+    if (num_groups_out)
+        *num_groups_out = 0;
+
+    if (!tdms_filename || !xlsx_filename)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    err = mapped_file_open(&tdms.mapped, tdms_filename);
+    if (err)
+        return err;
+
+    err = tdms_read_file(&tdms);
+    if (err)
+        goto done;
+
+    options.constant_memory = LXW_TRUE;
+    writer.workbook = workbook_new_opt_lv(xlsx_filename, &options);
+    if (!writer.workbook) {
+        err = LXW_ERROR_CREATING_XLSX_FILE;
+        goto done;
+    }
+
+    writer.header_format = workbook_add_format(writer.workbook);
+    writer.date_format = workbook_add_format(writer.workbook);
+    format_set_bold(writer.header_format);
+    format_set_num_format(writer.date_format, "yyyy-mm-dd hh:mm:ss.000");
+
+    for (group_id = 0; group_id < tdms.groups.count && !err; group_id++)
+        err = tdms_write_group(&writer, &tdms, group_id, chart_points);
+
+    if (!err && num_groups_out)
+        *num_groups_out = tdms.groups.count;
+
+    if (err)
+        workbook_close(writer.workbook);
+    else
+        err = workbook_close(writer.workbook);
+
+done:
+    arena_free(&writer.arena);
+    tdms_file_free(&tdms);
+    return err;
+}
+
+/* ============================================================================
+ * JSON import functions
+ * ============================================================================ */
+
+/*
+ * A forward-only JSON tokenizer. Rows are written as each object is read,
+ * so no document tree is ever built and memory use doesn't depend on the
+ * size of the input. Strings are scanned 8 bytes at a time for quotes and
+ * backslashes and unescaped into the arena's scratch buffer.
+ */
+typedef struct json_parser {
+    const char *start;
+    const char *p;
+    const char *end;
+    lv_arena *arena;
+    uint8_t error;
+} json_parser;
+
+#define JSON_ONES  0x0101010101010101ull
+#define JSON_HIGHS 0x8080808080808080ull
+
+/* Non-zero if any byte of the word equals byte. */
+static uint64_t
+swar_has_byte(uint64_t word, uint8_t byte)
+{
+    uint64_t x = word ^ (JSON_ONES * byte);
+
+    return (x - JSON_ONES) & ~x & JSON_HIGHS;
+}
+
+static void
+json_skip_space(json_parser *parser)
+{
+    while (parser->p < parser->end
+           && (*parser->p == ' ' || *parser->p == '\n' || *parser->p == '\r'
+               || *parser->p == '\t'))
+        parser->p++;
+}
+
+static int
+json_accept(json_parser *parser, char c)
+{
+    json_skip_space(parser);
+
+    if (parser->p < parser->end && *parser->p == c) {
+        parser->p++;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Find the closing quote of a string starting after the opening quote.
+ * Returns NULL if the string isn't terminated. */
+static const char *
+json_string_end(const char *p, const char *end, int *has_escapes)
+{
+    *has_escapes = 0;
+
+    for (;;) {
+        while (end - p >= 8) {
+            uint64_t word;
+
+            memcpy(&word, p, sizeof(word));
+            if (swar_has_byte(word, '"') || swar_has_byte(word, '\\'))
+                break;
+            p += 8;
+        }
+
+        while (p < end && *p != '"' && *p != '\\')
+            p++;
+
+        if (p >= end)
+            return NULL;
+
+        if (*p == '"')
+            return p;
+
+        /* Skip the escaped character. */
+        *has_escapes = 1;
+        p += 2;
+    }
+}
+
+static int
+json_hex4(const char *p, const char *end, uint32_t *value)
+{
+    int i;
+
+    *value = 0;
+    if (end - p < 4)
+        return 0;
+
+    for (i = 0; i < 4; i++) {
+        char c = p[i];
+
+        *value <<= 4;
+        if (c >= '0' && c <= '9')
+            *value |= (uint32_t) (c - '0');
+        else if (c >= 'a' && c <= 'f')
+            *value |= (uint32_t) (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            *value |= (uint32_t) (c - 'A' + 10);
+        else
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Read a string at the parser position, which must be the opening quote.
+ * The unescaped, NUL-terminated string is returned in the arena's scratch
+ * buffer and is only valid until the next string is read.
+ */
+static char *
+json_read_string(json_parser *parser, size_t *len)
+{
+    const char *p = parser->p + 1;
+    const char *close;
+    char *out;
+    size_t n = 0;
+    int has_escapes;
+
+    close = json_string_end(p, parser->end, &has_escapes);
+    if (!close || !arena_reserve_scratch(parser->arena,
+                                         (size_t) (close - p) + 1)) {
+        parser->error = 1;
+        return NULL;
+    }
+
+    out = parser->arena->scratch;
+    parser->p = close + 1;
+
+    if (!has_escapes) {
+        memcpy(out, p, (size_t) (close - p));
+        n = (size_t) (close - p);
+    }
+    else {
+        while (p < close) {
+            uint32_t code;
+
+            if (*p != '\\') {
+                out[n++] = *p++;
+                continue;
+            }
+
+            p++;
+            switch (*p++) {
+                case 'b':
+                    out[n++] = '\b';
+                    break;
+                case 'f':
+                    out[n++] = '\f';
+                    break;
+                case 'n':
+                    out[n++] = '\n';
+                    break;
+                case 'r':
+                    out[n++] = '\r';
+                    break;
+                case 't':
+                    out[n++] = '\t';
+                    break;
+                case 'u':
+                    if (!json_hex4(p, close, &code)) {
+                        parser->error = 1;
+                        return NULL;
+                    }
+                    p += 4;
+
+                    /* Combine a surrogate pair. */
+                    if (code >= 0xD800 && code < 0xDC00 && close - p >= 6
+                        && p[0] == '\\' && p[1] == 'u') {
+                        uint32_t low;
+
+                        if (json_hex4(p + 2, close, &low) && low >= 0xDC00
+                            && low < 0xE000) {
+                            code = 0x10000 + ((code - 0xD800) << 10)
+                                + (low - 0xDC00);
+                            p += 6;
+                        }
+                    }
+
+                    /* \\uXXXX takes 6 bytes, enough for its UTF-8. */
+                    if (code < 0x80) {
+                        out[n++] = (char) code;
+                    }
+                    else if (code < 0x800) {
+                        out[n++] = (char) (0xC0 | code >> 6);
+                        out[n++] = (char) (0x80 | (code & 0x3F));
+                    }
+                    else if (code < 0x10000) {
+                        out[n++] = (char) (0xE0 | code >> 12);
+                        out[n++] = (char) (0x80 | (code >> 6 & 0x3F));
+                        out[n++] = (char) (0x80 | (code & 0x3F));
+                    }
+                    else {
+                        out[n++] = (char) (0xF0 | code >> 18);
+                        out[n++] = (char) (0x80 | (code >> 12 & 0x3F));
+                        out[n++] = (char) (0x80 | (code >> 6 & 0x3F));
+                        out[n++] = (char) (0x80 | (code & 0x3F));
+                    }
+                    break;
+                default:
+                    out[n++] = p[-1];
+                    break;
+            }
+        }
+    }
+
+    out[n] = '\0';
+    *len = n;
+    return out;
+}
+
+static const double json_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Read a number. Numbers with up to 15 significant digits and a small
+ * exponent, nearly all real data, are converted exactly from an integer
+ * mantissa; anything else falls back to strtod().
+ */
+static double
+json_read_number(json_parser *parser)
+{
+    const char *p = parser->p;
+    const char *start = p;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    int negative = 0;
+    int exact = 1;
+    char buf[64];
+    double value;
+
+    if (p < parser->end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+
+    if (p >= parser->end || *p < '0' || *p > '9') {
+        parser->error = 1;
+        return 0;
+    }
+
+    for (; p < parser->end && *p >= '0' && *p <= '9'; p++) {
+        if (digits < 19)
+            mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+        else
+            exponent++;
+        if (mantissa || digits)
+            digits++;
+    }
+
+    if (p < parser->end && *p == '.') {
+        for (p++; p < parser->end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                exponent--;
+            }
+            if (mantissa || digits)
+                digits++;
+        }
+    }
+
+    if (p < parser->end && (*p == 'e' || *p == 'E')) {
+        int exp_negative = 0;
+        int exp_value = 0;
+
+        p++;
+        if (p < parser->end && (*p == '+' || *p == '-'))
+            exp_negative = *p++ == '-';
+
+        for (; p < parser->end && *p >= '0' && *p <= '9'; p++) {
+            if (exp_value < 10000)
+                exp_value = exp_value * 10 + (*p - '0');
+        }
+
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    parser->p = p;
+
+    if (digits > 15 || exponent < -22 || exponent > 22)
+        exact = 0;
+
+    if (exact) {
+        value = (double) mantissa;
+        value = exponent < 0 ? value / json_powers_of_ten[-exponent] :
+            value * json_powers_of_ten[exponent];
+        return negative ? -value : value;
+    }
+
+    if ((size_t) (p - start) >= sizeof(buf))
+        return NAN;
+
+    memcpy(buf, start, (size_t) (p - start));
+    buf[p - start] = '\0';
+    return strtod(buf, NULL);
+}
+
+static int
+json_accept_word(json_parser *parser, const char *word)
+{
+    size_t len = strlen(word);
+
+    if ((size_t) (parser->end - parser->p) >= len
+        && memcmp(parser->p, word, len) == 0) {
+        parser->p += len;
+        return 1;
+    }
+
+    parser->error = 1;
+    return 0;
+}
+
+/* Skip over any value, including nested objects and arrays. */
+static void
+json_skip_value(json_parser *parser)
+{
+    uint32_t depth = 0;
+
+    do {
+        const char *close;
+        int has_escapes;
+
+        json_skip_space(parser);
+        if (parser->p >= parser->end) {
+            parser->error = 1;
+            return;
+        }
+
+        switch (*parser->p) {
+            case '"':
+                close = json_string_end(parser->p + 1, parser->end,
+                                        &has_escapes);
+                if (!close) {
+                    parser->error = 1;
+                    return;
+                }
+                parser->p = close + 1;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                parser->p++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) {
+                    parser->error = 1;
+                    return;
+                }
+                depth--;
+                parser->p++;
+                break;
+            case ',':
+            case ':':
+                parser->p++;
+                break;
+            default:
+                /* Numbers and literals. Use memchr() so a NUL byte in the
+                 * input is skipped rather than matching the terminator. */
+                while (parser->p < parser->end
+                       && !memchr(" \t\r\n,:]}[{\"", *parser->p, 11))
+                    parser->p++;
+                break;
+        }
+    } while (depth && !parser->error);
+}
+
+/* Column for each key and the key names, from a column map or from the
+ * keys found in the data. */
+typedef struct json_columns {
+    lv_dict keys;
+    uint32_t *cols;
+} json_columns;
+
+/* Collect the keys of all objects in order of first appearance. */
+static lxw_error
+json_collect_keys(json_parser parser, json_columns *columns)
+{
+    uint32_t depth = 0;
+
+    while (!parser.error) {
+        json_skip_space(&parser);
+        if (parser.p >= parser.end)
+            break;
+
+        switch (*parser.p) {
+            case '{':
+            case '[':
+                depth++;
+                parser.p++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                parser.p++;
+                break;
+            case '"':{
+                size_t len;
+                const char *key = json_read_string(&parser, &len);
+
+                if (!key)
+                    break;
+
+                /* Keys of the row objects are followed by a colon. */
+                if (depth == 1 + (*parser.start == '[')
+                    && json_accept(&parser, ':')
+                    && dict_intern(&columns->keys, parser.arena, key, len) ==
+                    LV_DICT_NOT_FOUND)
+                    return LXW_ERROR_MEMORY_MALLOC_FAILED;
+                break;
+            }
+            default:
+                parser.p++;
+                break;
+        }
+    }
+
+    columns->cols = (uint32_t *) malloc((columns->keys.count + 1) *
+                                        sizeof(uint32_t));
+    if (!columns->cols)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    for (depth = 0; depth < columns->keys.count; depth++)
+        columns->cols[depth] = depth;
+
+    return LXW_NO_ERROR;
+}
+
+static lxw_error
+json_map_keys(lv_str_array_handle column_map, lv_arena *arena,
+              json_columns *columns)
+{
+    int32_t num_keys = lv_str_array_size(column_map);
+    int32_t i;
+
+    if (num_keys > LXW_COL_MAX)
+        num_keys = LXW_COL_MAX;
+
+    columns->cols = (uint32_t *) malloc(((size_t) num_keys + 1) *
+                                        sizeof(uint32_t));
+    if (!columns->cols)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    for (i = 0; i < num_keys; i++) {
+        int32_t len;
+        size_t utf8_len;
+        const char *key = lv_str_array_get(column_map, i, &len);
+        const char *utf8;
+        uint32_t count = columns->keys.count;
+        uint32_t id;
+
+        if (len == 0)
+            continue;
+
+        utf8 = arena_scratch_utf8(arena, key, len, &utf8_len);
+        id = utf8 ? dict_intern(&columns->keys, arena, utf8, utf8_len) :
+            LV_DICT_NOT_FOUND;
+        if (id == LV_DICT_NOT_FOUND)
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+        /* A repeated key keeps its first column. */
+        if (columns->keys.count > count)
+            columns->cols[id] = (uint32_t) i;
+    }
+
+    return LXW_NO_ERROR;
+}
+
+/* Read one object and write its mapped members as a row. */
+static lxw_error
+json_write_object(json_parser *parser, const json_columns *columns,
+                  lxw_worksheet *worksheet, lxw_row_t row,
+                  lxw_col_t first_col)
+{
+    lxw_error err = LXW_NO_ERROR;
+
+    if (!json_accept(parser, '{')) {
+        parser->error = 1;
+        return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+
+    if (json_accept(parser, '}'))
+        return LXW_NO_ERROR;
+
+    do {
+        size_t len;
+        const char *key;
+        uint32_t id;
+        lxw_col_t col;
+
+        json_skip_space(parser);
+        if (parser->p >= parser->end || *parser->p != '"') {
+            parser->error = 1;
+            break;
+        }
+
+        key = json_read_string(parser, &len);
+        if (!key || !json_accept(parser, ':')) {
+            parser->error = 1;
+            break;
+        }
+
+        id = dict_find(&columns->keys, key, len, dict_hash(key, len));
+        if (id == LV_DICT_NOT_FOUND
+            || (uint32_t) first_col + columns->cols[id] >= LXW_COL_MAX) {
+            json_skip_value(parser);
+            continue;
+        }
+
+        col = (lxw_col_t) (first_col + columns->cols[id]);
+        json_skip_space(parser);
+        if (parser->p >= parser->end) {
+            parser->error = 1;
+            break;
+        }
+
+        switch (*parser->p) {
+            case '"':{
+                const char *str = json_read_string(parser, &len);
+
+                if (str && len)
+                    err = worksheet_write_string(worksheet, row, col, str,
+                                                 NULL);
+                break;
+            }
+            case 't':
+                if (json_accept_word(parser, "true"))
+                    err = worksheet_write_boolean(worksheet, row, col, 1,
+                                                  NULL);
+                break;
+            case 'f':
+                if (json_accept_word(parser, "false"))
+                    err = worksheet_write_boolean(worksheet, row, col, 0,
+                                                  NULL);
+                break;
+            case 'n':
+                json_accept_word(parser, "null");
+                break;
+            case '{':
+            case '[':
+                json_skip_value(parser);
+                break;
+            default:{
+                double number = json_read_number(parser);
+
+                if (!parser->error && isfinite(number))
+                    err = worksheet_write_number(worksheet, row, col, number,
+                                                 NULL);
+                break;
+            }
+        }
+    } while (!err && !parser->error && json_accept(parser, ','));
+
+    if (!err && !parser->error && !json_accept(parser, '}'))
+        parser->error = 1;
+
+    if (err)
+        return err;
+
+    return parser->error ? LXW_ERROR_PARAMETER_VALIDATION : LXW_NO_ERROR;
+}
+
+/*
+ * Import JSON objects as rows: either an array of objects or a sequence
+ * of objects such as newline delimited JSON. source is a file path when
+ * source_is_path is set, otherwise the JSON text itself. Files are memory
+ * mapped.
+ *
+ * column_map lists the keys to import, each written to the column of its
+ * position in the array; other keys are ignored. Without a column map all
+ * keys become columns in order of first appearance, which costs an extra
+ * pass over the input. Numbers, strings and booleans are written as such,
+ * null and nested objects or arrays are left blank.
+ */
+lxw_error
+xlsx_import_json_lv(lxw_worksheet *worksheet, lxw_row_t first_row,
+                    lxw_col_t first_col, const char *source,
+                    uint8_t source_is_path, lv_str_array_handle column_map,
+                    uint8_t write_header, lxw_format *header_format,
+                    uint32_t *num_rows_out)
+{
+    lv_mapped_file mapped = { 0 };
+    lv_arena arena = { 0 };
+    json_columns columns = { { 0 }, NULL };
+    json_parser parser = { 0 };
+    lxw_row_t row = first_row;
+    lxw_row_t data_row = first_row;
+    uint32_t i;
+    int is_array;
+    lxw_error err;
+
+    if (num_rows_out)
+        *num_rows_out = 0;
+
+    if (!worksheet || !source)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (source_is_path) {
+        err = mapped_file_open(&mapped, source);
+        if (err)
+            return err;
+
+        parser.start = (const char *) mapped.data;
+        parser.end = parser.start + mapped.size;
+    }
+    else {
+        parser.start = source;
+        parser.end = source + strlen(source);
+    }
+
+    /* Skip a UTF-8 byte order mark. */
+    if (parser.end - parser.start >= 3
+        && memcmp(parser.start, "\xEF\xBB\xBF", 3) == 0)
+        parser.start += 3;
+
+    parser.p = parser.start;
+    parser.arena = &arena;
+
+    json_skip_space(&parser);
+    parser.start = parser.p;
+    is_array = parser.p < parser.end && *parser.p == '[';
+
+    if (lv_str_array_size(column_map))
+        err = json_map_keys(column_map, &arena, &columns);
+    else
+        err = json_collect_keys(parser, &columns);
+    if (err)
+        goto done;
+
+    if (write_header) {
+        for (i = 0; i < columns.keys.count && !err; i++) {
+            if ((uint32_t) first_col + columns.cols[i] < LXW_COL_MAX)
+                err = worksheet_write_string(worksheet, row,
+                                             (lxw_col_t) (first_col +
+                                                          columns.cols[i]),
+                                             columns.keys.strings[i],
+                                             header_format);
+        }
+
+        row++;
+    }
+
+    data_row = row;
+
+    if (is_array) {
+        parser.p++;
+        if (json_accept(&parser, ']'))
+            goto done;
+    }
+
+    while (!err) {
+        json_skip_space(&parser);
+        if (!is_array && parser.p >= parser.end)
+            break;
+
+        if (row >= LXW_ROW_MAX) {
+            err = LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+            break;
+        }
+
+        err = json_write_object(&parser, &columns, worksheet, row, first_col);
+        if (err)
+            break;
+
+        row++;
+
+        if (is_array) {
+            if (json_accept(&parser, ']'))
+                break;
+            if (!json_accept(&parser, ',')) {
+                err = LXW_ERROR_PARAMETER_VALIDATION;
+                break;
+            }
+        }
+        else {
+            json_accept(&parser, ',');
+        }
+    }
+
+done:
+    if (num_rows_out)
+        *num_rows_out = row - data_row;
+
+    free(columns.cols);
+    dict_free(&columns.keys);
+    arena_free(&arena);
+    mapped_file_close(&mapped);
+    return err;
+}
+
+/* ============================================================================
+ * Growing chart range functions
+ * ============================================================================ */
+
+/*
+ * A chart series whose ranges run from first_row to the last row written
+ * to the worksheet. The ranges start as the single first_row cell so the
+ * chart can be inserted straight away, and are widened, with optional
+ * defined names for them, in workbook_close_lv() when the final row count
+ * is known. Bindings are kept in a global list since LabVIEW may call into
+ * the DLL from several threads. A binding is only used if its worksheet
+ * and series are still part of the workbook being closed, since a
+ * workbook closed with plain workbook_close() leaves its bindings behind.
+ */
+typedef struct lv_row_binding {
+    lxw_workbook *workbook;
+    lxw_chart_series *series;
+    lxw_worksheet *worksheet;
+    lxw_row_t first_row;
+    lxw_col_t values_col;
+    int32_t categories_col;
+    char *values_name;
+    char *categories_name;
+    struct lv_row_binding *next;
+} lv_row_binding;
+
+static lv_row_binding *lv_row_bindings;
+
+#ifdef _WIN32
+static SRWLOCK lv_row_bindings_lock = SRWLOCK_INIT;
+#define LV_BINDINGS_LOCK()   AcquireSRWLockExclusive(&lv_row_bindings_lock)
+#define LV_BINDINGS_UNLOCK() ReleaseSRWLockExclusive(&lv_row_bindings_lock)
+#else
+static pthread_mutex_t lv_row_bindings_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LV_BINDINGS_LOCK()   pthread_mutex_lock(&lv_row_bindings_lock)
+#define LV_BINDINGS_UNLOCK() pthread_mutex_unlock(&lv_row_bindings_lock)
+#endif
+
+static void
+row_binding_free(lv_row_binding *binding)
+{
+    free(binding->values_name);
+    free(binding->categories_name);
+    free(binding);
+}
+
+/*
+ * Bind a series to the rows of a worksheet from first_row down to the
+ * last row written. categories_col is -1 for no categories. values_name
+ * and categories_name optionally define workbook names for the final
+ * ranges. The series gets a one row placeholder range now, so the chart
+ * can be inserted; the workbook must be closed with workbook_close_lv(),
+ * which widens it.
+ */
+lxw_error
+chart_series_bind_rows_lv(lxw_workbook *workbook, lxw_chart_series *series,
+                          lxw_worksheet *worksheet, lxw_row_t first_row,
+                          lxw_col_t values_col, int32_t categories_col,
+                          const char *values_name,
+                          const char *categories_name)
+{
+    lv_row_binding *binding;
+
+    if (!workbook || !series || !worksheet)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (first_row >= LXW_ROW_MAX || values_col >= LXW_COL_MAX
+        || categories_col >= LXW_COL_MAX)
+        return LXW_ERROR_WORKSHEET_INDEX_OUT_OF_RANGE;
+
+    binding = (lv_row_binding *) calloc(1, sizeof(lv_row_binding));
+    if (!binding)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    binding->workbook = workbook;
+    binding->series = series;
+    binding->worksheet = worksheet;
+    binding->first_row = first_row;
+    binding->values_col = values_col;
+    binding->categories_col = categories_col < 0 ? -1 : categories_col;
+
+    if (values_name && *values_name) {
+        binding->values_name = ansi_to_utf8(values_name);
+        if (!binding->values_name) {
+            row_binding_free(binding);
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+    }
+
+    if (categories_name && *categories_name && binding->categories_col >= 0) {
+        binding->categories_name = ansi_to_utf8(categories_name);
+        if (!binding->categories_name) {
+            row_binding_free(binding);
+            return LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+    }
+
+    /* worksheet_insert_chart() and chartsheet_set_chart() reject a series
+     * without values, so set a placeholder until the close. */
+    chart_series_set_values(series, worksheet->name, first_row, values_col,
+                            first_row, values_col);
+
+    if (binding->categories_col >= 0)
+        chart_series_set_categories(series, worksheet->name, first_row,
+                                    (lxw_col_t) binding->categories_col,
+                                    first_row,
+                                    (lxw_col_t) binding->categories_col);
+
+    LV_BINDINGS_LOCK();
+    binding->next = lv_row_bindings;
+    lv_row_bindings = binding;
+    LV_BINDINGS_UNLOCK();
+
+    return LXW_NO_ERROR;
+}
+
+/* Release a range's strings before it is set again, since the setters
+ * don't free a previous range. */
+static void
+series_range_reset(lxw_series_range *range)
+{
+    if (!range)
+        return;
+
+    free(range->formula);
+    free(range->sheetname);
+    range->formula = NULL;
+    range->sheetname = NULL;
+}
+
+/*
+ * Check that a binding's worksheet and series belong to the workbook,
+ * comparing pointers only, before anything of theirs is read. Bindings
+ * left by a workbook that was closed without workbook_close_lv() point to
+ * freed memory and must not be touched.
+ */
+static int
+row_binding_is_live(lxw_workbook *workbook, const lv_row_binding *binding)
+{
+    lxw_worksheet *worksheet;
+    lxw_chart *chart;
+    int found = 0;
+
+    STAILQ_FOREACH(worksheet, workbook->worksheets, list_pointers) {
+        if (worksheet == binding->worksheet) {
+            found = 1;
+            break;
+        }
+    }
+
+    if (!found)
+        return 0;
+
+    STAILQ_FOREACH(chart, workbook->charts, list_pointers) {
+        lxw_chart_series *series;
+
+        STAILQ_FOREACH(series, chart->series_list, list_pointers) {
+            if (series == binding->series)
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Define a workbook name for a single column range such as
+ * ='Sheet 1'!$B$2:$B$500. */
+static lxw_error
+row_binding_define_name(lxw_workbook *workbook, const char *name,
+                        const char *sheetname, lxw_row_t first_row,
+                        lxw_row_t last_row, lxw_col_t col)
+{
+    char col_name[4];
+    char *formula;
+    size_t size = strlen(sheetname) * 2 + 64;
+    size_t len = 0;
+    const char *p;
+    int i = 0;
+    lxw_error err;
+
+    /* Column letters, most significant first. */
+    col_name[3] = '\0';
+    i = 3;
+    do {
+        col_name[--i] = (char) ('A' + col % 26);
+        col /= 26;
+    } while (col-- > 0);
+
+    formula = (char *) malloc(size);
+    if (!formula)
+        return LXW_ERROR_MEMORY_MALLOC_FAILED;
+
+    formula[len++] = '=';
+    formula[len++] = '\'';
+    for (p = sheetname; *p; p++) {
+        if (*p == '\'')
+            formula[len++] = '\'';
+        formula[len++] = *p;
+    }
+
+    snprintf(formula + len, size - len, "'!$%s$%u:$%s$%u", col_name + i,
+             (unsigned) first_row + 1, col_name + i, (unsigned) last_row + 1);
+
+    err = workbook_define_name(workbook, name, formula);
+    free(formula);
+    return err;
+}
+
+/*
+ * Close a workbook, first extending every series bound with
+ * chart_series_bind_rows_lv() to the last row written to its worksheet
+ * and defining the bound names. Required instead of workbook_close() for
+ * workbooks with bound series, since it also releases the bindings; it is
+ * safe to use for any workbook.
+ */
+lxw_error
+workbook_close_lv(lxw_workbook *workbook)
+{
+    lv_row_binding *bindings = NULL;
+    lv_row_binding **link;
+    lxw_error err = LXW_NO_ERROR;
+    lxw_error close_err;
+
+    if (!workbook)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    /* Take this workbook's bindings off the global list. */
+    LV_BINDINGS_LOCK();
+    link = &lv_row_bindings;
+    while (*link) {
+        lv_row_binding *binding = *link;
+
+        if (binding->workbook == workbook) {
+            *link = binding->next;
+            binding->next = bindings;
+            bindings = binding;
+        }
+        else {
+            link = &binding->next;
+        }
+    }
+    LV_BINDINGS_UNLOCK();
+
+    while (bindings) {
+        lv_row_binding *binding = bindings;
+        lxw_worksheet *worksheet = binding->worksheet;
+        lxw_row_t last_row;
+        lxw_error name_err = LXW_NO_ERROR;
+
+        bindings = binding->next;
+
+        if (!row_binding_is_live(workbook, binding)) {
+            row_binding_free(binding);
+            continue;
+        }
+
+        last_row = worksheet->dim_rowmax > binding->first_row ?
+            worksheet->dim_rowmax : binding->first_row;
+
+        series_range_reset(binding->series->values);
+        chart_series_set_values(binding->series, worksheet->name,
+                                binding->first_row, binding->values_col,
+                                last_row, binding->values_col);
+
+        if (binding->values_name)
+            name_err = row_binding_define_name(workbook, binding->values_name,
+                                               worksheet->name,
+                                               binding->first_row, last_row,
+                                               binding->values_col);
+
+        if (binding->categories_col >= 0) {
+            lxw_col_t col = (lxw_col_t) binding->categories_col;
+
+            series_range_reset(binding->series->categories);
+            chart_series_set_categories(binding->series, worksheet->name,
+                                        binding->first_row, col, last_row,
+                                        col);
+
+            if (binding->categories_name && !name_err)
+                name_err = row_binding_define_name(workbook,
+                                                   binding->categories_name,
+                                                   worksheet->name,
+                                                   binding->first_row,
+                                                   last_row, col);
+        }
+
+        if (name_err && !err)
+            err = name_err;
+
+        row_binding_free(binding);
+    }
+
+    close_err = workbook_close(workbook);
+    return close_err ? close_err : err;
+}
+
+/* ============================================================================
+ * Page setup functions
+ * ============================================================================ */
+
+/* Bits of lxw_page_setup.present, one per group of settings. */
+enum lxw_page_setup_present {
+    LXW_PAGE_SETUP_ORIENTATION = 1 << 0,
+    LXW_PAGE_SETUP_PAPER = 1 << 1,
+    LXW_PAGE_SETUP_MARGINS = 1 << 2,
+    LXW_PAGE_SETUP_HEADER = 1 << 3,
+    LXW_PAGE_SETUP_FOOTER = 1 << 4,
+    LXW_PAGE_SETUP_PRINT_SCALE = 1 << 5,
+    LXW_PAGE_SETUP_FIT_TO_PAGES = 1 << 6,
+    LXW_PAGE_SETUP_REPEAT_ROWS = 1 << 7,
+    LXW_PAGE_SETUP_REPEAT_COLUMNS = 1 << 8,
+    LXW_PAGE_SETUP_PRINT_AREA = 1 << 9,
+    LXW_PAGE_SETUP_CENTER_HORIZONTALLY = 1 << 10,
+    LXW_PAGE_SETUP_CENTER_VERTICALLY = 1 << 11,
+    LXW_PAGE_SETUP_GRIDLINES = 1 << 12,
+    LXW_PAGE_SETUP_PRINT_HEADINGS = 1 << 13,
+    LXW_PAGE_SETUP_PRINT_ACROSS = 1 << 14,
+    LXW_PAGE_SETUP_BLACK_AND_WHITE = 1 << 15,
+    LXW_PAGE_SETUP_START_PAGE = 1 << 16,
+    LXW_PAGE_SETUP_PAGE_VIEW = 1 << 17
+};
+
+/*
+ * A page setup profile. Ordered by size with explicit padding, like the
+ * chart specs, so packed and natural layouts agree. Negative margins keep
+ * Excel's defaults.
+ */
+typedef struct lxw_page_setup {
+    double margin_left;
+    double margin_right;
+    double margin_top;
+    double margin_bottom;
+    double header_margin;
+    double footer_margin;
+    uint32_t present;
+    lxw_row_t repeat_first_row;
+    lxw_row_t repeat_last_row;
+    lxw_row_t print_first_row;
+    lxw_row_t print_last_row;
+    uint16_t print_scale;
+    uint16_t fit_width;
+    uint16_t fit_height;
+    uint16_t start_page;
+    lxw_col_t repeat_first_col;
+    lxw_col_t repeat_last_col;
+    lxw_col_t print_first_col;
+    lxw_col_t print_last_col;
+    uint8_t landscape;
+    uint8_t paper_type;
+    uint8_t gridlines;
+    uint8_t reserved;
+} lxw_page_setup;
+
+/* Apply a page setup. The header and footer are already UTF-8. Returns
+ * the first error but applies every setting. */
+static lxw_error
+page_setup_apply(lxw_worksheet *worksheet, const lxw_page_setup *setup,
+                 const char *header, const char *footer)
+{
+    uint32_t present = setup->present;
+    lxw_error err = LXW_NO_ERROR;
+    lxw_error result;
+
+    if (present & LXW_PAGE_SETUP_ORIENTATION) {
+        if (setup->landscape)
+            worksheet_set_landscape(worksheet);
+        else
+            worksheet_set_portrait(worksheet);
+    }
+
+    if (present & LXW_PAGE_SETUP_PAPER)
+        worksheet_set_paper(worksheet, setup->paper_type);
+
+    if (present & LXW_PAGE_SETUP_MARGINS)
+        worksheet_set_margins(worksheet, setup->margin_left,
+                              setup->margin_right, setup->margin_top,
+                              setup->margin_bottom);
+
+    if ((present & LXW_PAGE_SETUP_HEADER) && header) {
+        lxw_header_footer_options options = { 0 };
+
+        options.margin = setup->header_margin;
+        result = worksheet_set_header_opt(worksheet, header, &options);
+        if (result && !err)
+            err = result;
+    }
+
+    if ((present & LXW_PAGE_SETUP_FOOTER) && footer) {
+        lxw_header_footer_options options = { 0 };
+
+        options.margin = setup->footer_margin;
+        result = worksheet_set_footer_opt(worksheet, footer, &options);
+        if (result && !err)
+            err = result;
+    }
+
+    if (present & LXW_PAGE_SETUP_PRINT_SCALE)
+        worksheet_set_print_scale(worksheet, setup->print_scale);
+
+    if (present & LXW_PAGE_SETUP_FIT_TO_PAGES)
+        worksheet_fit_to_pages(worksheet, setup->fit_width,
+                               setup->fit_height);
+
+    if (present & LXW_PAGE_SETUP_REPEAT_ROWS) {
+        result = worksheet_repeat_rows(worksheet, setup->repeat_first_row,
+                                       setup->repeat_last_row);
+        if (result && !err)
+            err = result;
+    }
+
+    if (present & LXW_PAGE_SETUP_REPEAT_COLUMNS) {
+        result = worksheet_repeat_columns(worksheet, setup->repeat_first_col,
+                                          setup->repeat_last_col);
+        if (result && !err)
+            err = result;
+    }
+
+    if (present & LXW_PAGE_SETUP_PRINT_AREA) {
+        result = worksheet_print_area(worksheet, setup->print_first_row,
+                                      setup->print_first_col,
+                                      setup->print_last_row,
+                                      setup->print_last_col);
+        if (result && !err)
+            err = result;
+    }
+
+    if (present & LXW_PAGE_SETUP_CENTER_HORIZONTALLY)
+        worksheet_center_horizontally(worksheet);
+
+    if (present & LXW_PAGE_SETUP_CENTER_VERTICALLY)
+        worksheet_center_vertically(worksheet);
+
+    if (present & LXW_PAGE_SETUP_GRIDLINES)
+        worksheet_gridlines(worksheet, setup->gridlines);
+
+    if (present & LXW_PAGE_SETUP_PRINT_HEADINGS)
+        worksheet_print_row_col_headers(worksheet);
+
+    if (present & LXW_PAGE_SETUP_PRINT_ACROSS)
+        worksheet_print_across(worksheet);
+
+    if (present & LXW_PAGE_SETUP_BLACK_AND_WHITE)
+        worksheet_print_black_and_white(worksheet);
+
+    if (present & LXW_PAGE_SETUP_START_PAGE)
+        worksheet_set_start_page(worksheet, setup->start_page);
+
+    if (present & LXW_PAGE_SETUP_PAGE_VIEW)
+        worksheet_set_page_view(worksheet);
+
+    return err;
+}
+
+/*
+ * Apply a page setup profile to an array of worksheets. The header and
+ * footer are transcoded once for all of them. Null handles are skipped.
+ * Returns the first error; every worksheet is still set up.
+ */
+lxw_error
+worksheet_apply_page_setup_many_lv(lxw_worksheet **worksheets,
+                                   uint32_t count,
+                                   const lxw_page_setup *setup,
+                                   const char *header, const char *footer)
+{
+    char *utf8_header;
+    char *utf8_footer;
+    lxw_error err = LXW_NO_ERROR;
+    uint32_t i;
+
+    if (!worksheets || !setup)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    utf8_header = ansi_to_utf8(header);
+    utf8_footer = ansi_to_utf8(footer);
+
+    for (i = 0; i < count; i++) {
+        lxw_error result;
+
+        if (!worksheets[i])
+            continue;
+
+        result = page_setup_apply(worksheets[i], setup,
+                                  utf8_header ? utf8_header : header,
+                                  utf8_footer ? utf8_footer : footer);
+        if (result && !err)
+            err = result;
+    }
+
+    free(utf8_header);
+    free(utf8_footer);
+    return err;
+}
+
+/*
+ * Apply every setting of a page setup profile whose bit is set in
+ * setup->present. header and footer are passed separately as LabVIEW
+ * strings and used with the HEADER and FOOTER bits.
+ */
+lxw_error
+worksheet_apply_page_setup_lv(lxw_worksheet *worksheet,
+                              const lxw_page_setup *setup,
+                              const char *header, const char *footer)
+{
+    if (!worksheet)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    return worksheet_apply_page_setup_many_lv(&worksheet, 1, setup, header,
+                                              footer);
+}
+
+/* ============================================================================
+ * Page break functions
+ * ============================================================================ */
+
+/* Set a list of horizontal page breaks, at most LXW_BREAKS_MAX. breaks
+ * must have room for the zero terminator. */
+static lxw_error
+pagebreaks_set(lxw_worksheet *worksheet, lxw_row_t *breaks,
+               uint32_t num_breaks, uint32_t *num_breaks_out)
+{
+    if (num_breaks_out)
+        *num_breaks_out = num_breaks;
+
+    if (num_breaks == 0)
+        return LXW_NO_ERROR;
+
+    breaks[num_breaks] = 0;
+    return worksheet_set_h_pagebreaks(worksheet, breaks);
+}
+
+/*
+ * Set a page break every stride rows from first_row up to last_row, so
+ * that each page starts stride rows after the previous one. Breaks past
+ * Excel's limit of 1023 are dropped. num_breaks_out (may be NULL) gets
+ * the number set.
+ */
+lxw_error
+worksheet_set_pagebreaks_every_lv(lxw_worksheet *worksheet,
+                                  lxw_row_t first_row, lxw_row_t last_row,
+                                  uint32_t stride, uint32_t *num_breaks_out)
+{
+    lxw_row_t breaks[LXW_BREAKS_MAX + 1];
+    uint32_t num_breaks = 0;
+    uint64_t row;
+
+    if (num_breaks_out)
+        *num_breaks_out = 0;
+
+    if (!worksheet || stride == 0)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    for (row = (uint64_t) first_row + stride;
+         row <= last_row && num_breaks < LXW_BREAKS_MAX; row += stride)
+        breaks[num_breaks++] = (lxw_row_t) row;
+
+    return pagebreaks_set(worksheet, breaks, num_breaks, num_breaks_out);
+}
+
+static int
+staging_cells_equal(const lxw_staging_column *column, uint32_t row1,
+                    uint32_t row2)
+{
+    int blank1 = staging_column_is_blank(column, row1);
+    int blank2 = staging_column_is_blank(column, row2);
+
+    if (blank1 || blank2)
+        return blank1 && blank2;
+
+    /* Equal strings share a dictionary id. */
+    if (column->type == LXW_STAGING_COLUMN_STRING)
+        return column->ids[row1] == column->ids[row2];
+
+    return column->numbers[row1] == column->numbers[row2];
+}
+
+/*
+ * Start a new printed page wherever the value of a key column changes in
+ * the rows written by the last staging_table_emit_lv(), e.g. one page per
+ * serial number. col is the worksheet column, as for the staging table
+ * filter functions. Breaks past Excel's limit of 1023 are dropped.
+ * num_breaks_out (may be NULL) gets the number set.
+ */
+lxw_error
+staging_table_set_group_pagebreaks_lv(lxw_staging_table *table,
+                                      lxw_col_t col,
+                                      uint32_t *num_breaks_out)
+{
+    lxw_row_t breaks[LXW_BREAKS_MAX + 1];
+    const lxw_staging_column *column;
+    uint32_t num_breaks = 0;
+    uint32_t i;
+
+    if (num_breaks_out)
+        *num_breaks_out = 0;
+
+    if (!table || !table->emit_worksheet)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (col < table->emit_first_col
+        || col - table->emit_first_col >= table->num_cols)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    column = &table->columns[col - table->emit_first_col];
+
+    for (i = 1; i < table->emit_count && num_breaks < LXW_BREAKS_MAX; i++) {
+        if (!staging_cells_equal(column, table->emit_rows[i - 1],
+                                 table->emit_rows[i]))
+            breaks[num_breaks++] = table->emit_first_row + i;
+    }
+
+    return pagebreaks_set(table->emit_worksheet, breaks, num_breaks,
+                          num_breaks_out);
+}
+
+/* ============================================================================
+ * Worksheet view functions
+ * ============================================================================ */
+
+/* Bits of lxw_view_profile.present, one per setting. */
+enum lxw_view_profile_present {
+    LXW_VIEW_FREEZE_PANES = 1 << 0,
+    LXW_VIEW_SPLIT_PANES = 1 << 1,
+    LXW_VIEW_ZOOM = 1 << 2,
+    LXW_VIEW_GRIDLINES = 1 << 3,
+    LXW_VIEW_TAB_COLOR = 1 << 4,
+    LXW_VIEW_SELECTION = 1 << 5,
+    LXW_VIEW_TOP_LEFT_CELL = 1 << 6,
+    LXW_VIEW_HIDE_ZERO = 1 << 7,
+    LXW_VIEW_RIGHT_TO_LEFT = 1 << 8,
+    LXW_VIEW_PAGE_VIEW = 1 << 9,
+    LXW_VIEW_SELECT = 1 << 10,
+    LXW_VIEW_HIDE = 1 << 11
+};
+
+/* A worksheet view profile, laid out like lxw_page_setup. */
+typedef struct lxw_view_profile {
+    double split_vertical;
+    double split_horizontal;
+    uint32_t present;
+    lxw_row_t freeze_row;
+    lxw_row_t select_first_row;
+    lxw_row_t select_last_row;
+    lxw_row_t top_left_row;
+    lxw_color_t tab_color;
+    uint16_t zoom;
+    lxw_col_t freeze_col;
+    lxw_col_t select_first_col;
+    lxw_col_t select_last_col;
+    lxw_col_t top_left_col;
+    uint8_t gridlines;
+    uint8_t reserved[5];
+} lxw_view_profile;
+
+static lxw_error
+view_apply(lxw_worksheet *worksheet, const lxw_view_profile *view)
+{
+    uint32_t present = view->present;
+    lxw_error err = LXW_NO_ERROR;
+
+    if (present & LXW_VIEW_FREEZE_PANES)
+        worksheet_freeze_panes(worksheet, view->freeze_row,
+                               view->freeze_col);
+
+    if (present & LXW_VIEW_SPLIT_PANES)
+        worksheet_split_panes(worksheet, view->split_vertical,
+                              view->split_horizontal);
+
+    if (present & LXW_VIEW_ZOOM)
+        worksheet_set_zoom(worksheet, view->zoom);
+
+    if (present & LXW_VIEW_GRIDLINES)
+        worksheet_gridlines(worksheet, view->gridlines);
+
+    /* LabVIEW black is 0, which libxlsxwriter takes as unset. */
+    if (present & LXW_VIEW_TAB_COLOR)
+        worksheet_set_tab_color(worksheet, lv_point_color(view->tab_color));
+
+    if (present & LXW_VIEW_SELECTION)
+        err = worksheet_set_selection(worksheet, view->select_first_row,
+                                      view->select_first_col,
+                                      view->select_last_row,
+                                      view->select_last_col);
+
+    if (present & LXW_VIEW_TOP_LEFT_CELL)
+        worksheet_set_top_left_cell(worksheet, view->top_left_row,
+                                    view->top_left_col);
+
+    if (present & LXW_VIEW_HIDE_ZERO)
+        worksheet_hide_zero(worksheet);
+
+    if (present & LXW_VIEW_RIGHT_TO_LEFT)
+        worksheet_right_to_left(worksheet);
+
+    if (present & LXW_VIEW_PAGE_VIEW)
+        worksheet_set_page_view(worksheet);
+
+    if (present & LXW_VIEW_SELECT)
+        worksheet_select(worksheet);
+
+    if (present & LXW_VIEW_HIDE)
+        worksheet_hide(worksheet);
+
+    return err;
+}
+
+/*
+ * Apply every setting of a view profile whose bit is set in
+ * view->present.
+ */
+lxw_error
+worksheet_apply_view_lv(lxw_worksheet *worksheet,
+                        const lxw_view_profile *view)
+{
+    if (!worksheet || !view)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    return view_apply(worksheet, view);
+}
+
+/*
+ * Apply one view profile to an array of worksheets. Null handles are
+ * skipped. Returns the first error; every worksheet is still set up.
+ */
+lxw_error
+worksheet_apply_view_many_lv(lxw_worksheet **worksheets, uint32_t count,
+                             const lxw_view_profile *view)
+{
+    lxw_error err = LXW_NO_ERROR;
+    uint32_t i;
+
+    if (!worksheets || !view)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    for (i = 0; i < count; i++) {
+        lxw_error result;
+
+        if (!worksheets[i])
+            continue;
+
+        result = view_apply(worksheets[i], view);
+        if (result && !err)
+            err = result;
+    }
+
+    return err;
+}
+
+/* ============================================================================
+ * Batch worksheet functions
+ * ============================================================================ */
+
+/* Check the form of a UTF-8 sheet name, as workbook_validate_sheet_name()
+ * does, without the lookup of existing sheets. */
+static lxw_error
+sheet_name_check(const char *name, size_t len)
+{
+    size_t num_chars = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (((unsigned char) name[i] & 0xC0) != 0x80)
+            num_chars++;
+    }
+
+    if (num_chars > LXW_SHEETNAME_MAX)
+        return LXW_ERROR_SHEETNAME_LENGTH_EXCEEDED;
+
+    if (strpbrk(name, "[]:*?/\\"))
+        return LXW_ERROR_INVALID_SHEETNAME_CHARACTER;
+
+    if (name[0] == '\'' || name[len - 1] == '\'')
+        return LXW_ERROR_SHEETNAME_START_END_APOSTROPHE;
+
+    return LXW_NO_ERROR;
+}
+
+/*
+ * Add one worksheet per name in a LabVIEW string array. All the names are
+ * transcoded into one arena and checked in a single pass: their form, then
+ * uniqueness within the batch through a hash of the case-folded names
+ * (Excel sheet names are case insensitive; only ASCII letters are folded
+ * here), then clashes with sheets already in the workbook. Empty names
+ * get the default SheetN name. errors_out and handles_out (either may be
+ * NULL) get a code and a handle (0 on error) per name. Returns the first
+ * error; valid names are added even if others fail.
+ */
+lxw_error
+workbook_add_worksheets_lv(lxw_workbook *workbook, lv_str_array_handle names,
+                           uintptr_t *handles_out, int32_t *errors_out)
+{
+    lv_arena arena = { 0 };
+    lv_dict folded = { 0 };
+    int32_t num_names = lv_str_array_size(names);
+    lxw_error first_err = LXW_NO_ERROR;
+    int32_t i;
+
+    if (!workbook)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    for (i = 0; i < num_names; i++) {
+        lxw_worksheet *worksheet = NULL;
+        lxw_error err = LXW_NO_ERROR;
+        const char *utf8 = NULL;
+        size_t utf8_len = 0;
+        int32_t len;
+        const char *name = lv_str_array_get(names, i, &len);
+
+        if (len) {
+            utf8 = arena_scratch_utf8(&arena, name, len, &utf8_len);
+            if (!utf8)
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            else
+                err = sheet_name_check(utf8, utf8_len);
+        }
+
+        /* Fold in place in the scratch buffer, then keep the original
+         * spelling for the sheet. */
+        if (utf8 && !err) {
+            char *copy = arena_strndup(&arena, utf8, utf8_len);
+            uint32_t count = folded.count;
+            size_t j;
+
+            if (!copy) {
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+            }
+            else {
+                for (j = 0; j < utf8_len; j++)
+                    arena.scratch[j] =
+                        (char) ascii_tolower((unsigned char) utf8[j]);
+
+                if (dict_intern(&folded, &arena, arena.scratch, utf8_len)
+                    == LV_DICT_NOT_FOUND)
+                    err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+                else if (folded.count == count)
+                    err = LXW_ERROR_SHEETNAME_ALREADY_USED;
+                else if (workbook_get_worksheet_by_name(workbook, copy)
+                         || workbook_get_chartsheet_by_name(workbook, copy))
+                    err = LXW_ERROR_SHEETNAME_ALREADY_USED;
+            }
+
+            utf8 = copy;
+        }
+
+        if (!err) {
+            worksheet = workbook_add_worksheet(workbook, utf8);
+
+            /* A default name can clash with an explicit one. */
+            if (!worksheet && !utf8)
+                err = LXW_ERROR_SHEETNAME_ALREADY_USED;
+            else if (!worksheet)
+                err = workbook_validate_sheet_name(workbook, utf8);
+
+            if (!worksheet && !err)
+                err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        }
+
+        if (handles_out)
+            handles_out[i] = (uintptr_t) worksheet;
+        if (errors_out)
+            errors_out[i] = err;
+        if (err && !first_err)
+            first_err = err;
+    }
+
+    dict_free(&folded);
+    arena_free(&arena);
+    return first_err;
+}
+
+/* ============================================================================
+ * Document property functions
+ * ============================================================================ */
+
+/* Seconds from the LabVIEW epoch, 1904-01-01 00:00 UTC, to the Unix
+ * epoch. */
+#define LV_EPOCH_UNIX_SECONDS 2082844800.0
+
+/* An empty LabVIEW string leaves a property unset. */
+static const char *
+arena_property(lv_arena *arena, const char *str, int *failed)
+{
+    char *utf8;
+
+    if (!str || !*str)
+        return NULL;
+
+    utf8 = arena_utf8(arena, str, (int32_t) strlen(str));
+    if (!utf8)
+        *failed = 1;
+
+    return utf8;
+}
+
+/*
+ * Set the document properties from separate LabVIEW strings. Empty
+ * strings leave a property unset. created is a LabVIEW timestamp in
+ * seconds; 0 uses the time the file is written.
+ */
+lxw_error
+workbook_set_properties_lv(lxw_workbook *workbook, const char *title,
+                           const char *subject, const char *author,
+                           const char *manager, const char *company,
+                           const char *category, const char *keywords,
+                           const char *comments, const char *status,
+                           const char *hyperlink_base, double created)
+{
+    lv_arena arena = { 0 };
+    lxw_doc_properties properties;
+    int failed = 0;
+    lxw_error err;
+
+    if (!workbook)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    memset(&properties, 0, sizeof(properties));
+    properties.title = arena_property(&arena, title, &failed);
+    properties.subject = arena_property(&arena, subject, &failed);
+    properties.author = arena_property(&arena, author, &failed);
+    properties.manager = arena_property(&arena, manager, &failed);
+    properties.company = arena_property(&arena, company, &failed);
+    properties.category = arena_property(&arena, category, &failed);
+    properties.keywords = arena_property(&arena, keywords, &failed);
+    properties.comments = arena_property(&arena, comments, &failed);
+    properties.status = arena_property(&arena, status, &failed);
+    properties.hyperlink_base = arena_property(&arena, hyperlink_base,
+                                               &failed);
+
+    if (created > LV_EPOCH_UNIX_SECONDS)
+        properties.created = (time_t) (created - LV_EPOCH_UNIX_SECONDS);
+
+    err = failed ? LXW_ERROR_MEMORY_MALLOC_FAILED
+        : workbook_set_properties(workbook, &properties);
+
+    arena_free(&arena);
+    return err;
+}
+
+typedef enum lxw_custom_property_type {
+    LXW_CUSTOM_PROPERTY_STRING = 0,
+    LXW_CUSTOM_PROPERTY_NUMBER,
+    LXW_CUSTOM_PROPERTY_INTEGER,
+    LXW_CUSTOM_PROPERTY_BOOLEAN,
+    LXW_CUSTOM_PROPERTY_DATETIME
+} lxw_custom_property_type;
+
+/* Number of days in a month of the Gregorian calendar. */
+static int
+days_in_month(int year, int month)
+{
+    static const int days[] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+        return 29;
+
+    return days[month - 1];
+}
+
+/* Parse "YYYY-MM-DD", optionally followed by " HH:MM:SS" or "THH:MM:SS"
+ * with fractional seconds. */
+static int
+parse_property_datetime(const char *str, lxw_datetime *datetime)
+{
+    int consumed = 0;
+    char sep;
+
+    memset(datetime, 0, sizeof(lxw_datetime));
+
+    if (sscanf(str, "%4d-%2d-%2d%n", &datetime->year, &datetime->month,
+               &datetime->day, &consumed) != 3)
+        return 0;
+
+    str += consumed;
+    if (*str) {
+        if (sscanf(str, "%c%2d:%2d:%lf%n", &sep, &datetime->hour,
+                   &datetime->min, &datetime->sec, &consumed) != 4
+            || (sep != ' ' && sep != 'T') || str[consumed])
+            return 0;
+    }
+
+    return datetime->month >= 1 && datetime->month <= 12
+        && datetime->day >= 1
+        && datetime->day <= days_in_month(datetime->year, datetime->month)
+        && datetime->hour >= 0 && datetime->hour < 24
+        && datetime->min >= 0 && datetime->min < 60
+        && datetime->sec >= 0 && datetime->sec < 60;
+}
+
+/* Set one custom property from its UTF-8 name and value text. */
+static lxw_error
+custom_property_set(lxw_workbook *workbook, const char *name,
+                    const char *value, uint8_t type)
+{
+    char *end;
+
+    switch (type) {
+        case LXW_CUSTOM_PROPERTY_STRING:
+            return workbook_set_custom_property_string(workbook, name, value);
+
+        case LXW_CUSTOM_PROPERTY_NUMBER:
+        {
+            double number = strtod(value, &end);
+
+            if (end == value || *end || !isfinite(number))
+                return LXW_ERROR_PARAMETER_VALIDATION;
+
+            return workbook_set_custom_property_number(workbook, name,
+                                                       number);
+        }
+
+        case LXW_CUSTOM_PROPERTY_INTEGER:
+        {
+            long long integer = strtoll(value, &end, 10);
+
+            if (end == value || *end || integer < INT32_MIN
+                || integer > INT32_MAX)
+                return LXW_ERROR_PARAMETER_VALIDATION;
+
+            return workbook_set_custom_property_integer(workbook, name,
+                                                        (int32_t) integer);
+        }
+
+        case LXW_CUSTOM_PROPERTY_BOOLEAN:
+            if (strcmp(value, "1") == 0
+                || ascii_strcasecmp(value, "true") == 0)
+                return workbook_set_custom_property_boolean(workbook, name,
+                                                            1);
+
+            if (strcmp(value, "0") == 0
+                || ascii_strcasecmp(value, "false") == 0)
+                return workbook_set_custom_property_boolean(workbook, name,
+                                                            0);
+
+            return LXW_ERROR_PARAMETER_VALIDATION;
+
+        case LXW_CUSTOM_PROPERTY_DATETIME:
+        {
+            lxw_datetime datetime;
+
+            if (!parse_property_datetime(value, &datetime))
+                return LXW_ERROR_PARAMETER_VALIDATION;
+
+            return workbook_set_custom_property_datetime(workbook, name,
+                                                         &datetime);
+        }
+
+        default:
+            return LXW_ERROR_PARAMETER_VALIDATION;
+    }
+}
+
+/*
+ * Set many custom properties in one call. names and values are LabVIEW
+ * string arrays and types holds an lxw_custom_property_type per property;
+ * non-string values are given as text ("3.5", "42", "true",
+ * "2024-05-01 13:45:00") and parsed natively. All strings are transcoded
+ * into one arena. errors_out (may be NULL) gets a code per property.
+ * Returns the first error; the other properties are still set.
+ */
+lxw_error
+workbook_set_custom_properties_lv(lxw_workbook *workbook,
+                                  lv_str_array_handle names,
+                                  lv_str_array_handle values,
+                                  const uint8_t *types, int32_t *errors_out)
+{
+    lv_arena arena = { 0 };
+    int32_t num_names = lv_str_array_size(names);
+    int32_t num_values = lv_str_array_size(values);
+    lxw_error first_err = LXW_NO_ERROR;
+    int32_t i;
+
+    if (!workbook || !types)
+        return LXW_ERROR_NULL_PARAMETER_IGNORED;
+
+    if (num_values != num_names)
+        return LXW_ERROR_PARAMETER_VALIDATION;
+
+    for (i = 0; i < num_names; i++) {
+        const char *name;
+        const char *value;
+        int32_t name_len, value_len;
+        lxw_error err;
+
+        name = lv_str_array_get(names, i, &name_len);
+        value = lv_str_array_get(values, i, &value_len);
+
+        name = arena_utf8(&arena, name, name_len);
+        value = arena_utf8(&arena, value, value_len);
+
+        if (!name || !value)
+            err = LXW_ERROR_MEMORY_MALLOC_FAILED;
+        else if (!*name)
+            err = LXW_ERROR_PARAMETER_IS_EMPTY;
+        else
+            err = custom_property_set(workbook, name, value, types[i]);
+
+        if (errors_out)
+            errors_out[i] = err;
+        if (err && !first_err)
+            first_err = err;
+    }
+
+    arena_free(&arena);
+    return first_err;
+}